@@ -0,0 +1,169 @@
+/**
+ * @file bench_integrator.cpp
+ * @brief Full integration steps of the shipped systems and their stages, over particle count, thread count and
+ * density. Run with --benchmark_out=<file> --benchmark_out_format=json (or build bench_integrator_json) to keep the
+ * results for comparison, e.g., with google-benchmark's tools/compare.py.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ctiprd/cpu/integrators/EulerMaruyama.h>
+
+#include "workloads.h"
+
+namespace {
+
+using DoubleWell = ctiprd::systems::DoubleWell<float>;
+using MichaelisMenten = ctiprd::systems::MichaelisMenten<float>;
+using LotkaVolterra = ctiprd::systems::LotkaVolterra<float>;
+using LotkaVolterra3D = ctiprd::systems::LotkaVolterra3D<float>;
+
+template<typename System>
+using Particles = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions,
+                                                  ctiprd::cpu::particles::forces>;
+
+/**
+ * Particle count, threads and the percentage of the box volume the particles are confined to.
+ */
+template<typename System>
+void arguments(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"n", "workers", "fill"})
+            ->ArgsProduct({ctiprd::bench::particleCounts<System>(), ctiprd::bench::threadCounts(), {100, 10}})
+            ->Unit(benchmark::kMillisecond)
+            ->UseRealTime();
+}
+
+/**
+ * A populated collection together with its pool and a copy of the initial configuration, so that mutating stages
+ * can start every iteration from the same state.
+ */
+template<typename System>
+struct Setup {
+    explicit Setup(const benchmark::State &state)
+            : n(static_cast<std::size_t>(state.range(0))), fill(static_cast<double>(state.range(2)) / 100.),
+              pool(ctiprd::config::make_pool(static_cast<int>(state.range(1)))),
+              particles(std::make_shared<Particles<System>>()) {
+        ctiprd::bench::populate(*particles, n, fill, pool);
+        initial = *particles;
+    }
+
+    void report(benchmark::State &state) const {
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * n));
+        state.counters["density"] = static_cast<double>(n) / ctiprd::bench::occupiedVolume<System>(fill);
+    }
+
+    std::size_t n;
+    double fill;
+    ctiprd::config::PoolPtr<> pool;
+    std::shared_ptr<Particles<System>> particles;
+    Particles<System> initial;
+};
+
+}
+
+template<typename System>
+static void Step(benchmark::State &state) {
+    Setup<System> setup {state};
+    ctiprd::cpu::integrator::EulerMaruyama<System> integrator {System{}, setup.pool};
+    const auto particles = integrator.particles();
+    for (auto _ : state) {
+        state.PauseTiming();
+        *particles = setup.initial;
+        state.ResumeTiming();
+        integrator.step(ctiprd::bench::Workload<System>::dt);
+    }
+    setup.report(state);
+}
+
+BENCHMARK_TEMPLATE(Step, DoubleWell)->Apply(arguments<DoubleWell>);
+BENCHMARK_TEMPLATE(Step, MichaelisMenten)->Apply(arguments<MichaelisMenten>);
+BENCHMARK_TEMPLATE(Step, LotkaVolterra)->Apply(arguments<LotkaVolterra>);
+BENCHMARK_TEMPLATE(Step, LotkaVolterra3D)->Apply(arguments<LotkaVolterra3D>);
+
+template<typename System>
+static void ReactionNeighborListUpdate(benchmark::State &state) {
+    Setup<System> setup {state};
+    ctiprd::cpu::UncontrolledApproximation<Particles<System>, System> reactions {System{}};
+    for (auto _ : state) {
+        reactions.neighborLists_.update(setup.particles.get(), setup.pool);
+    }
+    setup.report(state);
+}
+
+BENCHMARK_TEMPLATE(ReactionNeighborListUpdate, DoubleWell)->Apply(arguments<DoubleWell>);
+BENCHMARK_TEMPLATE(ReactionNeighborListUpdate, MichaelisMenten)->Apply(arguments<MichaelisMenten>);
+BENCHMARK_TEMPLATE(ReactionNeighborListUpdate, LotkaVolterra)->Apply(arguments<LotkaVolterra>);
+BENCHMARK_TEMPLATE(ReactionNeighborListUpdate, LotkaVolterra3D)->Apply(arguments<LotkaVolterra3D>);
+
+/**
+ * The force pass including the update of its neighbor list if there are pair potentials. Michaelis-Menten has no
+ * potentials and is left out.
+ */
+template<typename System>
+static void Forces(benchmark::State &state) {
+    Setup<System> setup {state};
+    ctiprd::cpu::potentials::ForceField<Particles<System>, System> forceField {System{}};
+    for (auto _ : state) {
+        forceField.forces(setup.particles, setup.pool);
+    }
+    setup.report(state);
+}
+
+BENCHMARK_TEMPLATE(Forces, DoubleWell)->Apply(arguments<DoubleWell>);
+BENCHMARK_TEMPLATE(Forces, LotkaVolterra)->Apply(arguments<LotkaVolterra>);
+BENCHMARK_TEMPLATE(Forces, LotkaVolterra3D)->Apply(arguments<LotkaVolterra3D>);
+
+template<typename System>
+static void ReactionScreening(benchmark::State &state) {
+    Setup<System> setup {state};
+    ctiprd::cpu::UncontrolledApproximation<Particles<System>, System> reactions {System{}};
+    reactions.updateProbabilities(ctiprd::bench::Workload<System>::dt);
+    reactions.neighborLists_.update(setup.particles.get(), setup.pool);
+    std::size_t nEvents {0};
+    for (auto _ : state) {
+        const auto events = reactions.screen(setup.particles, setup.pool);
+        nEvents += events.size();
+        benchmark::DoNotOptimize(events.data());
+    }
+    setup.report(state);
+    state.counters["events"] = benchmark::Counter(static_cast<double>(nEvents), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_TEMPLATE(ReactionScreening, DoubleWell)->Apply(arguments<DoubleWell>);
+BENCHMARK_TEMPLATE(ReactionScreening, MichaelisMenten)->Apply(arguments<MichaelisMenten>);
+BENCHMARK_TEMPLATE(ReactionScreening, LotkaVolterra)->Apply(arguments<LotkaVolterra>);
+BENCHMARK_TEMPLATE(ReactionScreening, LotkaVolterra3D)->Apply(arguments<LotkaVolterra3D>);
+
+/**
+ * Shuffle and resolution of one step's events, always starting from the same events and configuration.
+ */
+template<typename System>
+static void ReactionResolution(benchmark::State &state) {
+    Setup<System> setup {state};
+    ctiprd::cpu::UncontrolledApproximation<Particles<System>, System> reactions {System{}};
+    reactions.updateProbabilities(ctiprd::bench::Workload<System>::dt);
+    reactions.neighborLists_.update(setup.particles.get(), setup.pool);
+    const auto screened = reactions.screen(setup.particles, setup.pool);
+
+    auto events = screened;
+    for (auto _ : state) {
+        state.PauseTiming();
+        *setup.particles = setup.initial;
+        events = screened;
+        state.ResumeTiming();
+        reactions.resolve(events, *setup.particles);
+    }
+    setup.report(state);
+    state.counters["events"] = static_cast<double>(screened.size());
+}
+
+BENCHMARK_TEMPLATE(ReactionResolution, DoubleWell)->Apply(arguments<DoubleWell>);
+BENCHMARK_TEMPLATE(ReactionResolution, MichaelisMenten)->Apply(arguments<MichaelisMenten>);
+BENCHMARK_TEMPLATE(ReactionResolution, LotkaVolterra)->Apply(arguments<LotkaVolterra>);
+BENCHMARK_TEMPLATE(ReactionResolution, LotkaVolterra3D)->Apply(arguments<LotkaVolterra3D>);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,257 @@
+/**
+ * @file bench_neighbor_list.cpp
+ * @brief NeighborList construction, update and traversal throughput over particle count (density), cutoff, cell
+ * subdivision, dimension, periodicity and cell storage (dense with adjacency tables or stencils, sparse), for
+ * uniformly placed and for clustered particles where a handful of cells hold all of them. The boxes are those of
+ * LotkaVolterra (10 x 50) and LotkaVolterra3D (10 x 10 x 10).
+ */
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ctiprd/cpu/NeighborList.h>
+#include <ctiprd/cpu/ParticleCollection.h>
+
+#include "workloads.h"
+
+namespace {
+
+using System2D = ctiprd::systems::LotkaVolterra<float>;
+using System3D = ctiprd::systems::LotkaVolterra3D<float>;
+
+template<typename System>
+using Particles = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions,
+                                                  ctiprd::cpu::particles::forces>;
+
+template<typename System, bool periodic>
+using NeighborList = ctiprd::cpu::nl::NeighborList<System::DIM, periodic, float>;
+
+/**
+ * Upper bound on the cell adjacency tables of a configuration, finer grids are skipped.
+ */
+constexpr double maxAdjacencyBytes = 256. * (1 << 20);
+
+constexpr std::size_t maxClusteredParticles = 10'000;
+
+float cutoffOf(const benchmark::State &state) {
+    return static_cast<float>(state.range(1)) / 100.f;
+}
+
+/**
+ * Bytes of the head array and adjacency tables of a NeighborList over the system's box.
+ */
+template<typename System>
+double adjacencyBytes(double cutoff, long nSubdivides) {
+    double cells {1.};
+    for (const auto length : System::boxSize) {
+        cells *= std::floor(static_cast<double>(length) / (cutoff / static_cast<double>(nSubdivides)));
+    }
+    const auto stencil = std::pow(2. * static_cast<double>(nSubdivides) + 1., static_cast<double>(System::DIM));
+    return cells * (stencil + 3.) * sizeof(std::size_t);
+}
+
+/**
+ * Grid argument: dense with an adjacency table, dense with a stencil or sparse.
+ */
+constexpr long tableGrid = 0;
+constexpr long sparseGrid = 2;
+
+/**
+ * The adjacency goes first so that a list constructed sparse only builds its dense grid once.
+ */
+template<typename NL>
+void configure(NL &neighborList, long grid) {
+    neighborList.setAdjacency(grid == tableGrid ? ctiprd::cpu::nl::Adjacency::table
+                                                : ctiprd::cpu::nl::Adjacency::stencil);
+    neighborList.setGrid(grid == sparseGrid ? ctiprd::cpu::nl::CellGrid::sparse : ctiprd::cpu::nl::CellGrid::dense);
+}
+
+/**
+ * Particle count, cutoff in hundredths, number of subdivides per cutoff, whether the particles are clustered and
+ * the grid. Clustered runs are limited in size as the number of pairs grows quadratically, only grids with adjacency
+ * tables are limited in their number of cells.
+ */
+template<typename System>
+void arguments(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"n", "cutoff", "sub", "clustered", "grid"})->Unit(benchmark::kMicrosecond)->UseRealTime();
+    for (const long clustered : {0, 1}) {
+        for (const long n : {1'000, 10'000, 100'000}) {
+            if (clustered && static_cast<std::size_t>(n) > maxClusteredParticles) {
+                continue;
+            }
+            for (const long cutoff : {25, 50, 100}) {
+                for (const long sub : {1, 2, 3, 4}) {
+                    for (const long grid : {0, 1, 2}) {
+                        if (grid != tableGrid ||
+                            adjacencyBytes<System>(static_cast<double>(cutoff) / 100., sub) <= maxAdjacencyBytes) {
+                            benchmark->Args({n, cutoff, sub, clustered, grid});
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Cutoff in hundredths, number of subdivides and the dense grid, for construction which does not depend on the
+ * particles.
+ */
+template<typename System>
+void constructionArguments(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"cutoff", "sub", "grid"})->Unit(benchmark::kMicrosecond);
+    for (const long cutoff : {25, 50, 100}) {
+        for (const long sub : {1, 2, 3, 4}) {
+            for (const long grid : {0, 1}) {
+                if (grid != tableGrid ||
+                    adjacencyBytes<System>(static_cast<double>(cutoff) / 100., sub) <= maxAdjacencyBytes) {
+                    benchmark->Args({cutoff, sub, grid});
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Normally distributed around the origin with a standard deviation of a quarter cell, so that the 2^DIM cells
+ * touching the origin hold nearly all particles.
+ */
+template<typename System>
+void populateClustered(Particles<System> &particles, std::size_t n, float cellSize) {
+    using Position = typename Particles<System>::Position;
+    std::mt19937 generator {42};
+    std::normal_distribution<float> normal {0.f, cellSize / 4.f};
+    std::vector<Position> positions (n);
+    std::vector<std::size_t> types (n, 0);
+    for (auto &position : positions) {
+        for (std::size_t d = 0; d < System::DIM; ++d) {
+            position[d] = normal(generator);
+        }
+    }
+    particles.addParticles(std::span<const Position>{positions}, std::span<const std::size_t>{types});
+}
+
+template<typename System, bool periodic>
+struct Setup {
+    explicit Setup(const benchmark::State &state)
+            : n(static_cast<std::size_t>(state.range(0))),
+              pool(ctiprd::config::make_pool(static_cast<int>(ctiprd::bench::threadCounts().back()))),
+              particles(std::make_unique<Particles<System>>()),
+              neighborList(System::boxSize, cutoffOf(state), static_cast<int>(state.range(2))) {
+        configure(neighborList, state.range(4));
+        if (state.range(3)) {
+            populateClustered<System>(*particles, n, cutoffOf(state) / static_cast<float>(state.range(2)));
+        } else {
+            ctiprd::bench::populate(*particles, n, 1., pool);
+        }
+        neighborList.update(particles.get(), pool);
+    }
+
+    void report(benchmark::State &state) const {
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * n));
+        state.counters["cells"] = static_cast<double>(neighborList.nCellsTotal());
+    }
+
+    std::size_t n;
+    ctiprd::config::PoolPtr<> pool;
+    std::unique_ptr<Particles<System>> particles;
+    NeighborList<System, periodic> neighborList;
+};
+
+}
+
+template<typename System, bool periodic>
+static void Construct(benchmark::State &state) {
+    const auto cutoff = static_cast<float>(state.range(0)) / 100.f;
+    for (auto _ : state) {
+        NeighborList<System, periodic> neighborList {System::boxSize, cutoff, static_cast<int>(state.range(1)),
+                                                     ctiprd::cpu::nl::CellGrid::sparse};
+        configure(neighborList, state.range(2));
+        benchmark::DoNotOptimize(&neighborList);
+    }
+    state.counters["adjacency_bytes"] = state.range(2) == tableGrid ? adjacencyBytes<System>(cutoff, state.range(1))
+                                                                    : 0.;
+}
+
+template<typename System, bool periodic>
+static void Update(benchmark::State &state) {
+    Setup<System, periodic> setup {state};
+    for (auto _ : state) {
+        setup.neighborList.update(setup.particles.get(), setup.pool);
+    }
+    setup.report(state);
+}
+
+/**
+ * All pairs of particles in adjacent cells via forEachNeighborInCell, each pair visited once.
+ */
+template<typename System, bool periodic>
+static void Traverse(benchmark::State &state) {
+    Setup<System, periodic> setup {state};
+    std::atomic<std::size_t> nPairs {0};
+    for (auto _ : state) {
+        const auto worker = [&neighborList = setup.neighborList, &nPairs](auto cellIndex) {
+            std::size_t local {0};
+            neighborList.template forEachNeighborInCell<false>([&local](auto, auto) { ++local; }, cellIndex);
+            nPairs += local;
+        };
+        for (auto &future : setup.neighborList.forEachCell(worker, setup.pool)) {
+            future.wait();
+        }
+    }
+    setup.report(state);
+    state.counters["pairs"] = benchmark::Counter(static_cast<double>(nPairs), benchmark::Counter::kAvgIterations);
+}
+
+/**
+ * Pairs within the cutoff via forEachPairInRange, as used by reaction screening.
+ */
+template<typename System, bool periodic>
+static void PairsInRange(benchmark::State &state) {
+    Setup<System, periodic> setup {state};
+    const auto cutoffSquared = cutoffOf(state) * cutoffOf(state);
+    std::atomic<std::size_t> nPairs {0};
+    for (auto _ : state) {
+        const auto worker = [&setup, cutoffSquared, &nPairs](auto cellIndex) {
+            std::size_t local {0};
+            setup.neighborList.forEachPairInRange(*setup.particles, cellIndex, cutoffSquared,
+                                                  [&local](auto, auto, auto) { ++local; });
+            nPairs += local;
+        };
+        for (auto &future : setup.neighborList.forEachCell(worker, setup.pool)) {
+            future.wait();
+        }
+    }
+    setup.report(state);
+    state.counters["pairs"] = benchmark::Counter(static_cast<double>(nPairs), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_TEMPLATE(Construct, System2D, true)->Apply(constructionArguments<System2D>);
+BENCHMARK_TEMPLATE(Construct, System3D, true)->Apply(constructionArguments<System3D>);
+BENCHMARK_TEMPLATE(Construct, System2D, false)->Apply(constructionArguments<System2D>);
+BENCHMARK_TEMPLATE(Construct, System3D, false)->Apply(constructionArguments<System3D>);
+
+BENCHMARK_TEMPLATE(Update, System2D, true)->Apply(arguments<System2D>);
+BENCHMARK_TEMPLATE(Update, System3D, true)->Apply(arguments<System3D>);
+BENCHMARK_TEMPLATE(Update, System2D, false)->Apply(arguments<System2D>);
+BENCHMARK_TEMPLATE(Update, System3D, false)->Apply(arguments<System3D>);
+
+BENCHMARK_TEMPLATE(Traverse, System2D, true)->Apply(arguments<System2D>);
+BENCHMARK_TEMPLATE(Traverse, System3D, true)->Apply(arguments<System3D>);
+BENCHMARK_TEMPLATE(Traverse, System2D, false)->Apply(arguments<System2D>);
+BENCHMARK_TEMPLATE(Traverse, System3D, false)->Apply(arguments<System3D>);
+
+BENCHMARK_TEMPLATE(PairsInRange, System2D, true)->Apply(arguments<System2D>);
+BENCHMARK_TEMPLATE(PairsInRange, System3D, true)->Apply(arguments<System3D>);
+BENCHMARK_TEMPLATE(PairsInRange, System2D, false)->Apply(arguments<System2D>);
+BENCHMARK_TEMPLATE(PairsInRange, System3D, false)->Apply(arguments<System3D>);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,216 @@
+/**
+ * @file bench_scaling.cpp
+ * @brief Strong and weak scaling of one of the shipped systems over worker counts 1, 2, 4, ... up to a maximum.
+ * Strong scaling keeps the total particle count fixed, weak scaling the count per worker, with the occupied part of
+ * the box growing along so that the density stays the same. Reports time per step, speedup, parallel efficiency and
+ * the time per step of each phase, optionally as JSON.
+ *
+ * Usage: bench_scaling <DoubleWell|MichaelisMenten|LotkaVolterra|LotkaVolterra3D> [--mode strong|weak]
+ *        [--particles n] [--max-workers n] [--steps n] [--warmup n] [--json file]
+ *
+ * With --mode weak, --particles is the count per worker.
+ */
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <ctiprd/cpu/integrators/EulerMaruyama.h>
+
+#include "workloads.h"
+
+namespace {
+
+struct Options {
+    std::string system;
+    bool weak {false};
+    std::size_t particles {10'000};
+    std::size_t maxWorkers {0};
+    std::size_t steps {20};
+    std::size_t warmup {2};
+    std::string json;
+};
+
+struct Run {
+    std::size_t workers;
+    std::size_t particles;
+    double secondsPerStep;
+    double speedup;
+    double efficiency;
+    ctiprd::util::Profile profile;
+};
+
+Options parse(int argc, char **argv) {
+    if (argc < 2) {
+        throw std::invalid_argument("missing system name");
+    }
+    Options options {.system = argv[1]};
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view flag {argv[i]};
+        if (i + 1 == argc) {
+            throw std::invalid_argument(fmt::format("missing value for {}", flag));
+        }
+        const std::string value {argv[++i]};
+        if (flag == "--mode") {
+            if (value != "strong" && value != "weak") {
+                throw std::invalid_argument(fmt::format("unknown mode {}", value));
+            }
+            options.weak = value == "weak";
+        } else if (flag == "--particles") {
+            options.particles = std::stoul(value);
+        } else if (flag == "--max-workers") {
+            options.maxWorkers = std::stoul(value);
+        } else if (flag == "--steps") {
+            options.steps = std::stoul(value);
+        } else if (flag == "--warmup") {
+            options.warmup = std::stoul(value);
+        } else if (flag == "--json") {
+            options.json = value;
+        } else {
+            throw std::invalid_argument(fmt::format("unknown option {}", flag));
+        }
+    }
+    return options;
+}
+
+/**
+ * Worker counts 1, 2, 4, ... up to the maximum, which is always included.
+ */
+std::vector<std::size_t> workerCounts(std::size_t maxWorkers) {
+    std::vector<std::size_t> out;
+    for (std::size_t n = 1; n < maxWorkers; n *= 2) {
+        out.push_back(n);
+    }
+    out.push_back(maxWorkers);
+    return out;
+}
+
+/**
+ * Times steps of a freshly populated system on a pool of its own. The phases are only timed once the warm-up steps
+ * are done.
+ */
+template<typename System>
+Run run(std::size_t workers, std::size_t particles, double fill, const Options &options) {
+    auto pool = ctiprd::config::make_pool(static_cast<int>(workers));
+    ctiprd::cpu::integrator::EulerMaruyama<System> integrator {System{}, pool};
+    ctiprd::bench::populate(*integrator.particles(), particles, fill, pool);
+
+    const auto dt = ctiprd::bench::Workload<System>::dt;
+    for (std::size_t t = 0; t < options.warmup; ++t) {
+        integrator.step(dt);
+    }
+    integrator.resetProfile();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t t = 0; t < options.steps; ++t) {
+        integrator.step(dt);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return {workers, particles, elapsed.count() / static_cast<double>(options.steps), 0., 0., integrator.profile()};
+}
+
+/**
+ * Strong scaling: speedup t_1 / t_p and efficiency speedup / p. Weak scaling: efficiency t_1 / t_p and the scaled
+ * speedup p * efficiency.
+ */
+template<typename System>
+std::vector<Run> scale(const Options &options) {
+    const auto counts = workerCounts(options.maxWorkers);
+    std::vector<Run> runs;
+    for (const auto workers : counts) {
+        const auto particles = options.weak ? options.particles * workers : options.particles;
+        const auto fill = options.weak ? static_cast<double>(workers) / static_cast<double>(counts.back()) : 1.;
+        runs.push_back(run<System>(workers, particles, fill, options));
+
+        auto &current = runs.back();
+        const auto ratio = runs.front().secondsPerStep / current.secondsPerStep;
+        const auto p = static_cast<double>(workers);
+        current.speedup = options.weak ? p * ratio : ratio;
+        current.efficiency = options.weak ? ratio : ratio / p;
+    }
+    return runs;
+}
+
+std::vector<Run> scale(const Options &options) {
+    using dtype = float;
+    if (options.system == "DoubleWell") {
+        return scale<ctiprd::systems::DoubleWell<dtype>>(options);
+    } else if (options.system == "MichaelisMenten") {
+        return scale<ctiprd::systems::MichaelisMenten<dtype>>(options);
+    } else if (options.system == "LotkaVolterra") {
+        return scale<ctiprd::systems::LotkaVolterra<dtype>>(options);
+    } else if (options.system == "LotkaVolterra3D") {
+        return scale<ctiprd::systems::LotkaVolterra3D<dtype>>(options);
+    }
+    throw std::invalid_argument(fmt::format("unknown system {}", options.system));
+}
+
+double phaseMillisPerStep(const Run &run, std::size_t phase, std::size_t steps) {
+    return 1e3 * run.profile.seconds[phase] / static_cast<double>(steps);
+}
+
+void print(const std::vector<Run> &runs, const Options &options) {
+    fmt::print("{} scaling of {}, {} steps\n", options.weak ? "weak" : "strong", options.system, options.steps);
+    fmt::print("{:>8} {:>10} {:>12} {:>8} {:>10}", "workers", "particles", "ms/step", "speedup", "efficiency");
+    for (const auto *name : ctiprd::util::phaseNames) {
+        fmt::print(" {:>22}", name);
+    }
+    fmt::print("\n");
+    for (const auto &run : runs) {
+        fmt::print("{:>8} {:>10} {:>12.4f} {:>8.2f} {:>10.2f}", run.workers, run.particles, 1e3 * run.secondsPerStep,
+                   run.speedup, run.efficiency);
+        for (std::size_t phase = 0; phase < ctiprd::util::nPhases; ++phase) {
+            fmt::print(" {:>22.4f}", phaseMillisPerStep(run, phase, options.steps));
+        }
+        fmt::print("\n");
+    }
+}
+
+void writeJson(const std::vector<Run> &runs, const Options &options) {
+    std::ofstream out {options.json};
+    if (!out) {
+        throw std::runtime_error(fmt::format("could not open {}", options.json));
+    }
+    out << fmt::format(R"({{"system": "{}", "mode": "{}", "steps": {}, "runs": [)", options.system,
+                       options.weak ? "weak" : "strong", options.steps);
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        const auto &run = runs[i];
+        out << fmt::format(R"({}{{"workers": {}, "particles": {}, "seconds_per_step": {}, "speedup": {}, )"
+                           R"("efficiency": {}, "phases_ms_per_step": {{)", i == 0 ? "" : ", ", run.workers,
+                           run.particles, run.secondsPerStep, run.speedup, run.efficiency);
+        for (std::size_t phase = 0; phase < ctiprd::util::nPhases; ++phase) {
+            out << fmt::format(R"({}"{}": {})", phase == 0 ? "" : ", ", ctiprd::util::phaseNames[phase],
+                               phaseMillisPerStep(run, phase, options.steps));
+        }
+        out << "}}";
+    }
+    out << "]}\n";
+}
+
+}
+
+int main(int argc, char **argv) {
+    try {
+        auto options = parse(argc, argv);
+        if (options.maxWorkers == 0) {
+            options.maxWorkers = static_cast<std::size_t>(ctiprd::bench::threadCounts().back());
+        }
+        const auto runs = scale(options);
+        print(runs, options);
+        if (!options.json.empty()) {
+            writeJson(runs, options);
+        }
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "{}\nusage: {} <DoubleWell|MichaelisMenten|LotkaVolterra|LotkaVolterra3D> "
+                           "[--mode strong|weak] [--particles n] [--max-workers n] [--steps n] [--warmup n] "
+                           "[--json file]\n", e.what(), argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file bench_trajectory.cpp
+ * @brief Compression ratio and encode throughput of quantized trajectory frames.
+ */
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ctiprd/io/TrajectoryCodec.h>
+
+namespace {
+
+constexpr std::array<float, 2> boxSize {10.f, 50.f};
+constexpr std::size_t nTypes = 3;
+
+/**
+ * Random-walk frames of a 2D box, the step size resembles LV diffusion (D = 0.01, dt = 1e-2, recorded every step).
+ */
+struct Frames {
+    Frames(std::size_t nParticles, std::size_t nFrames) : types(nParticles) {
+        std::mt19937 generator {42};
+        std::uniform_real_distribution<float> uniform {-.5f, .5f};
+        std::normal_distribution<float> normal {0.f, std::sqrt(2.f * 0.01f * 1e-2f)};
+
+        std::vector<float> current (2 * nParticles);
+        for (std::size_t i = 0; i < nParticles; ++i) {
+            current[2 * i] = boxSize[0] * uniform(generator);
+            current[2 * i + 1] = boxSize[1] * uniform(generator);
+            // particles are typically added in bulk per type
+            types[i] = static_cast<std::uint8_t>(i * nTypes / nParticles);
+        }
+        for (std::size_t k = 0; k < nFrames; ++k) {
+            positions.push_back(current);
+            for (std::size_t i = 0; i < current.size(); ++i) {
+                auto &x = current[i];
+                const auto l = boxSize[i % 2];
+                x += normal(generator);
+                x -= l * std::floor(x / l + .5f);
+            }
+        }
+    }
+
+    std::vector<std::vector<float>> positions;
+    std::vector<std::uint8_t> types;
+};
+
+}
+
+static void EncodeQuantized(benchmark::State &state) {
+    const auto nParticles = static_cast<std::size_t>(state.range(0));
+    const ctiprd::io::QuantizationOptions options {.precision = 1. / static_cast<double>(state.range(1))};
+    const Frames frames {nParticles, 16};
+    const auto rawFrameBytes = nParticles * (2 * sizeof(float) + sizeof(std::uint8_t));
+
+    std::vector<char> out;
+    std::size_t encodedBytes {0};
+    std::size_t encodedFrames {0};
+    ctiprd::io::QuantizedEncoder<float, std::uint8_t, 2> encoder {boxSize, nTypes, options};
+    for (auto _ : state) {
+        for (const auto &positions : frames.positions) {
+            out.clear();
+            encodedBytes += encoder.encode(positions, frames.types, out);
+            ++encodedFrames;
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(encodedFrames * rawFrameBytes));
+    state.counters["ratio"] = static_cast<double>(encodedFrames * rawFrameBytes) / static_cast<double>(encodedBytes);
+}
+
+BENCHMARK(EncodeQuantized)->ArgsProduct({{1 << 12, 1 << 16}, {1000, 100000}})->Unit(benchmark::kMicrosecond);
+
+static void DecodeQuantized(benchmark::State &state) {
+    const auto nParticles = static_cast<std::size_t>(state.range(0));
+    const ctiprd::io::QuantizationOptions options {.precision = 1. / static_cast<double>(state.range(1)),
+                                                   .keyframeInterval = 16};
+    const Frames frames {nParticles, 16};
+    const auto rawFrameBytes = nParticles * (2 * sizeof(float) + sizeof(std::uint8_t));
+
+    ctiprd::io::QuantizedEncoder<float, std::uint8_t, 2> encoder {boxSize, nTypes, options};
+    std::vector<std::vector<char>> payloads;
+    for (const auto &positions : frames.positions) {
+        payloads.emplace_back();
+        encoder.encode(positions, frames.types, payloads.back());
+    }
+
+    const auto &axes = encoder.axes();
+    ctiprd::io::QuantizedDecoder decoder {2, nTypes, {begin(axes), end(axes)}};
+    std::vector<float> positions;
+    std::vector<std::uint8_t> types;
+    std::vector<std::uint64_t> counts;
+    std::size_t decodedFrames {0};
+    for (auto _ : state) {
+        for (std::size_t k = 0; k < payloads.size(); ++k) {
+            decoder.decode(reinterpret_cast<const std::byte *>(payloads[k].data()), payloads[k].size(), k == 0);
+            decoder.groupedByType(positions, types, counts);
+            ++decodedFrames;
+        }
+        benchmark::DoNotOptimize(positions.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(decodedFrames * rawFrameBytes));
+}
+
+BENCHMARK(DecodeQuantized)->ArgsProduct({{1 << 12, 1 << 16}, {1000, 100000}})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,129 @@
+/**
+ * @file workloads.h
+ * @brief The shipped systems as benchmark workloads: time steps, sizes and reproducible initial configurations.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <ctiprd/config.h>
+#include <ctiprd/systems/double_well.h>
+#include <ctiprd/systems/lotka_volterra.h>
+#include <ctiprd/systems/michaelis_menten.h>
+
+namespace ctiprd::bench {
+
+/**
+ * Per system time step and the largest particle count that is still tractable in its (fixed) box. Pairs grow with the
+ * density and the resolution of reaction events is quadratic in their number, which bounds all of them well below
+ * 10^7 particles; the double well's repulsion has a cutoff of a fifth of the box.
+ */
+template<typename System>
+struct Workload;
+
+template<typename T>
+struct Workload<systems::DoubleWell<T>> {
+    static constexpr const char *name = "DoubleWell";
+    static constexpr double dt = 1e-3;
+    static constexpr std::size_t maxParticles = 10'000;
+};
+
+template<typename T>
+struct Workload<systems::MichaelisMenten<T>> {
+    static constexpr const char *name = "MichaelisMenten";
+    static constexpr double dt = 1e-5;
+    static constexpr std::size_t maxParticles = 100'000;
+};
+
+template<typename T>
+struct Workload<systems::LotkaVolterra<T>> {
+    static constexpr const char *name = "LotkaVolterra";
+    static constexpr double dt = 1e-2;
+    static constexpr std::size_t maxParticles = 1'000'000;
+};
+
+template<typename T>
+struct Workload<systems::LotkaVolterra3D<T>> {
+    static constexpr const char *name = "LotkaVolterra3D";
+    static constexpr double dt = 1e-2;
+    static constexpr std::size_t maxParticles = 1'000'000;
+};
+
+/**
+ * Volume of the part of the box the particles are placed in.
+ *
+ * @param fill fraction of the box volume which is occupied, in (0, 1]
+ */
+template<typename System>
+double occupiedVolume(double fill) {
+    double volume {fill};
+    for (const auto length : System::boxSize) {
+        volume *= static_cast<double>(length);
+    }
+    return volume;
+}
+
+/**
+ * Places n particles uniformly in a box centered cube occupying a fraction fill of the box volume, types are assigned
+ * round-robin. The configuration only depends on the seed.
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+void populate(Particles &particles, std::size_t n, double fill, config::PoolPtr<Pool> pool = nullptr,
+              std::uint32_t seed = 42) {
+    using System = typename Particles::SystemType;
+    using Position = typename Particles::Position;
+    using dtype = typename Particles::dtype;
+
+    const auto scale = static_cast<dtype>(std::pow(fill, 1. / static_cast<double>(Particles::DIM)));
+    std::mt19937 generator {seed};
+    std::array<std::uniform_real_distribution<dtype>, Particles::DIM> distributions;
+    for (std::size_t d = 0; d < Particles::DIM; ++d) {
+        const auto half = scale * System::boxSize[d] / 2;
+        distributions[d] = std::uniform_real_distribution<dtype>{-half, half};
+    }
+
+    std::vector<Position> positions (n);
+    std::vector<std::size_t> types (n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t d = 0; d < Particles::DIM; ++d) {
+            positions[i][d] = distributions[d](generator);
+        }
+        types[i] = i % System::types.size();
+    }
+    particles.addParticles(std::span<const Position>{positions}, std::span<const std::size_t>{types}, pool);
+}
+
+/**
+ * Thread counts 1, 2, 4, ... up to the hardware concurrency, which is always included.
+ */
+inline std::vector<long> threadCounts() {
+    const auto hardware = static_cast<long>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<long> out;
+    for (long n = 1; n < hardware; n *= 2) {
+        out.push_back(n);
+    }
+    out.push_back(hardware);
+    return out;
+}
+
+/**
+ * Particle counts 10^3, 10^4, ... up to the limit of the workload.
+ */
+template<typename System>
+std::vector<long> particleCounts() {
+    std::vector<long> out;
+    for (std::size_t n = 1000; n <= Workload<System>::maxParticles; n *= 10) {
+        out.push_back(static_cast<long>(n));
+    }
+    return out;
+}
+
+}
@@ -10,6 +10,7 @@
 
 #include <ctiprd/systems/lotka_volterra.h>
 #include <ctiprd/binding/system_bindings.h>
+#include <ctiprd/binding/particles.h>
 #include <ctiprd/progressbar.hpp>
 
 #include <ctiprd/cpu/integrators/EulerMaruyama.h>
@@ -50,12 +51,8 @@ PYBIND11_MODULE(lv_mod, m) {
 
         auto pool = ctiprd::config::make_pool(njobs);
         auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
-        for(auto i = 0; i < prey.shape(0); ++i) {
-            integrator.particles()->addParticle({prey.at(i, 0), prey.at(i, 1)}, "prey");
-        }
-        for(auto i = 0; i < predator.shape(0); ++i) {
-            integrator.particles()->addParticle({predator.at(i, 0), predator.at(i, 1)}, "predator");
-        }
+        ctiprd::binding::addParticles(*integrator.particles(), prey, "prey", pool);
+        ctiprd::binding::addParticles(*integrator.particles(), predator, "predator", pool);
 
         {
             py::gil_scoped_release release;
@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <tuple>
 #include <optional>
+#include <stdexcept>
 
 #include <ctiprd/vec.h>
 #include <ctiprd/potentials/external.h>
@@ -16,6 +17,11 @@
 
 #include <ctiprd/config.h>
 #include <ctiprd/binding/system_bindings.h>
+#include <ctiprd/binding/trajectory_file.h>
+#include <ctiprd/binding/observables.h>
+#include <ctiprd/binding/particles.h>
+#include <ctiprd/binding/profiler.h>
+#include <ctiprd/io/TrajectoryWriter.h>
 #include <ctiprd/progressbar.hpp>
 
 #include <ctiprd/cpu/integrators/EulerMaruyama.h>
@@ -166,6 +172,7 @@ struct LotkaVolterra2d {
 };
 
 using System = LotkaVolterra2d<float>;
+using Integrator = ctiprd::cpu::integrator::EulerMaruyama<System>;
 namespace py = pybind11;
 
 template<typename T>
@@ -185,42 +192,200 @@ void check_shape(const np_array <System::dtype> &arr) {
     }
 }
 
+void check_stride(std::size_t stride) {
+    if (stride == 0) {
+        throw std::invalid_argument("Stride needs to be positive but was 0.");
+    }
+}
+
+template<typename Integrator, typename Pool>
+void populate(Integrator &integrator, ctiprd::config::PoolPtr<Pool> pool, const np_array <System::dtype> &prey,
+              const np_array <System::dtype> &predator, const np_array<System::dtype> &walls) {
+    check_shape(predator);
+    check_shape(prey);
+    check_shape(walls);
+
+    ctiprd::binding::addParticles(*integrator.particles(), prey, "prey", pool);
+    ctiprd::binding::addParticles(*integrator.particles(), predator, "predator", pool);
+    ctiprd::binding::addParticles(*integrator.particles(), walls, "barrier", pool);
+}
+
 PYBIND11_MODULE(lv2d_mod, m) {
     ctiprd::binding::exportBaseTypes<System::dtype>(m);
     ctiprd::binding::exportSystem<System>(m, "LotkaVolterra");
+    ctiprd::binding::exportTrajectoryFile(m);
+    ctiprd::binding::exportObservables<Integrator::Particles>(m);
+    ctiprd::binding::exportParticles<Integrator::Particles>(m);
+    ctiprd::binding::exportProfile(m);
+    ctiprd::binding::exportTrace(m);
 
     m.def("simulate", [](std::size_t nSteps, float dt, int njobs,
                          const np_array <System::dtype> &prey, const np_array <System::dtype> &predator,
                          const np_array<System::dtype> &walls,
                          py::handle progressCallback) {
-        check_shape(predator);
-        check_shape(prey);
-        check_shape(walls);
-
         System system{};
 
         ctiprd::binding::Trajectory<System> traj;
 
         auto pool = ctiprd::config::make_pool(njobs);
         auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
-        for (auto i = 0; i < prey.shape(0); ++i) {
-            integrator.particles()->addParticle({prey.at(i, 0), prey.at(i, 1)}, "prey");
+        populate(integrator, pool, prey, predator, walls);
+
+        {
+            py::gil_scoped_release release;
+            for (std::size_t step = 0; step < nSteps; ++step) {
+                if (step % 20 == 0) {
+                    traj.record(step, integrator, pool);
+                }
+
+                integrator.step(dt);
+
+                if (step % 5 == 0) {
+                    py::gil_scoped_acquire acquire;
+                    if (PyErr_CheckSignals() != 0) {
+                        throw py::error_already_set();
+                    }
+
+                    progressCallback(step);
+                }
+            }
+        }
+
+        pool->stop();
+        return traj;
+    });
+    m.def("simulate_live", [](std::size_t nSteps, float dt, int njobs,
+                              const np_array <System::dtype> &prey, const np_array <System::dtype> &predator,
+                              const np_array<System::dtype> &walls, std::size_t stride, py::handle callback) {
+        check_stride(stride);
+        System system{};
+
+        auto pool = ctiprd::config::make_pool(njobs);
+        Integrator integrator {system, pool};
+        populate(integrator, pool, prey, predator, walls);
+
+        {
+            py::gil_scoped_release release;
+            for (std::size_t step = 0; step < nSteps; ++step) {
+                integrator.step(dt);
+
+                if (step % stride == 0) {
+                    py::gil_scoped_acquire acquire;
+                    if (PyErr_CheckSignals() != 0) {
+                        throw py::error_already_set();
+                    }
+
+                    // the callback sees the live collection, views it takes are only valid until it returns
+                    callback(step, integrator.particles());
+                }
+            }
         }
-        for (auto i = 0; i < predator.shape(0); ++i) {
-            integrator.particles()->addParticle({predator.at(i, 0), predator.at(i, 1)}, "predator");
+
+        pool->stop();
+    });
+    m.def("simulate_profiled", [](std::size_t nSteps, float dt, int njobs,
+                                  const np_array <System::dtype> &prey, const np_array <System::dtype> &predator,
+                                  const np_array<System::dtype> &walls) {
+        System system{};
+
+        auto pool = ctiprd::config::make_pool(njobs);
+        Integrator integrator {system, pool};
+        populate(integrator, pool, prey, predator, walls);
+
+        {
+            py::gil_scoped_release release;
+            for (std::size_t step = 0; step < nSteps; ++step) {
+                integrator.step(dt);
+            }
         }
 
-        for (auto i = 0; i < walls.shape(0); ++i) {
-            integrator.particles()->addParticle({walls.at(i, 0), walls.at(i, 1)}, "barrier");
+        pool->stop();
+        return integrator.profile();
+    });
+    m.def("simulate_to_file", [](std::size_t nSteps, float dt, int njobs,
+                                 const np_array <System::dtype> &prey, const np_array <System::dtype> &predator,
+                                 const np_array<System::dtype> &walls, const std::string &trajectoryFile,
+                                 std::size_t stride, py::handle progressCallback) {
+        check_stride(stride);
+        System system{};
+
+        auto pool = ctiprd::config::make_pool(njobs);
+        auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+        populate(integrator, pool, prey, predator, walls);
+
+        {
+            ctiprd::io::TrajectoryWriter<System> writer {trajectoryFile};
+
+            py::gil_scoped_release release;
+            for (std::size_t step = 0; step < nSteps; ++step) {
+                if (step % stride == 0) {
+                    writer.record(step, integrator, pool);
+                }
+
+                integrator.step(dt);
+
+                if (step % 5 == 0) {
+                    py::gil_scoped_acquire acquire;
+                    if (PyErr_CheckSignals() != 0) {
+                        throw py::error_already_set();
+                    }
+
+                    progressCallback(step);
+                }
+            }
         }
 
+        pool->stop();
+        return ctiprd::binding::TrajectoryFile{trajectoryFile};
+    });
+    m.def("simulate_rdf", [](std::size_t nSteps, float dt, int njobs,
+                             const np_array <System::dtype> &prey, const np_array <System::dtype> &predator,
+                             const np_array<System::dtype> &walls, std::size_t stride, float rMax, std::size_t nBins,
+                             py::handle progressCallback) {
+        check_stride(stride);
+        System system{};
+
+        auto pool = ctiprd::config::make_pool(njobs);
+        Integrator integrator {system, pool};
+        populate(integrator, pool, prey, predator, walls);
+        auto rdf = integrator.observables().add<ctiprd::cpu::observables::RadialDistribution<Integrator::Particles>>(
+                stride, (nSteps + stride - 1) / stride, rMax, nBins);
+
         {
             py::gil_scoped_release release;
             for (std::size_t step = 0; step < nSteps; ++step) {
-                if (step % 20 == 0) {
-                    traj.record(step, integrator, pool);
+                integrator.step(dt);
+
+                if (step % 5 == 0) {
+                    py::gil_scoped_acquire acquire;
+                    if (PyErr_CheckSignals() != 0) {
+                        throw py::error_already_set();
+                    }
+
+                    progressCallback(step);
                 }
+            }
+        }
+
+        pool->stop();
+        return rdf;
+    });
+    m.def("simulate_density", [](std::size_t nSteps, float dt, int njobs,
+                                 const np_array <System::dtype> &prey, const np_array <System::dtype> &predator,
+                                 const np_array<System::dtype> &walls, std::size_t stride, std::size_t nx,
+                                 std::size_t ny, py::handle progressCallback) {
+        check_stride(stride);
+        System system{};
+
+        auto pool = ctiprd::config::make_pool(njobs);
+        Integrator integrator {system, pool};
+        populate(integrator, pool, prey, predator, walls);
+        auto density = integrator.observables().add<ctiprd::cpu::observables::DensityGrid<Integrator::Particles>>(
+                stride, (nSteps + stride - 1) / stride, std::array<std::size_t, System::DIM> {nx, ny});
 
+        {
+            py::gil_scoped_release release;
+            for (std::size_t step = 0; step < nSteps; ++step) {
                 integrator.step(dt);
 
                 if (step % 5 == 0) {
@@ -235,6 +400,6 @@ PYBIND11_MODULE(lv2d_mod, m) {
         }
 
         pool->stop();
-        return traj;
+        return density;
     });
 }
@@ -12,6 +12,7 @@
 
 #include <ctiprd/config.h>
 #include <ctiprd/binding/system_bindings.h>
+#include <ctiprd/binding/particles.h>
 #include <ctiprd/progressbar.hpp>
 
 #include <ctiprd/cpu/integrators/EulerMaruyama.h>
@@ -199,16 +200,9 @@ PYBIND11_MODULE(lv3d_mod, m) {
 
         auto pool = ctiprd::config::make_pool(njobs);
         auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
-        for (auto i = 0; i < prey.shape(0); ++i) {
-            integrator.particles()->addParticle({prey.at(i, 0), prey.at(i, 1), prey.at(i, 2)}, "prey");
-        }
-        for (auto i = 0; i < predator.shape(0); ++i) {
-            integrator.particles()->addParticle({predator.at(i, 0), predator.at(i, 1), predator.at(i, 2)}, "predator");
-        }
-
-        for (auto i = 0; i < walls.shape(0); ++i) {
-            integrator.particles()->addParticle({walls.at(i, 0), walls.at(i, 1), walls.at(i, 2)}, "barrier");
-        }
+        ctiprd::binding::addParticles(*integrator.particles(), prey, "prey", pool);
+        ctiprd::binding::addParticles(*integrator.particles(), predator, "predator", pool);
+        ctiprd::binding::addParticles(*integrator.particles(), walls, "barrier", pool);
 
         {
             py::gil_scoped_release release;
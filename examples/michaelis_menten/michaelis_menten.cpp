@@ -13,56 +13,35 @@
 #include <ctiprd/reactions/doi.h>
 #include <ctiprd/systems/util.h>
 #include <ctiprd/binding/system_bindings.h>
+#include <ctiprd/binding/observables.h>
 #include <ctiprd/cpu/integrators/EulerMaruyama.h>
+#include <ctiprd/cpu/observables/basic.h>
 
 namespace py = pybind11;
 
 using System = ctiprd::systems::MichaelisMenten<float>;
+using Integrator = ctiprd::cpu::integrator::EulerMaruyama<System>;
+using Counts = ctiprd::cpu::observables::ParticleCounts<Integrator::Particles>;
+using Events = ctiprd::cpu::observables::ReactionCounts<Integrator::Particles>;
 
 PYBIND11_MODULE(mm_mod, m) {
     ctiprd::binding::exportBaseTypes<System::dtype>(m);
     ctiprd::binding::exportSystem<System>(m, "MichaelisMenten");
+    ctiprd::binding::exportObservables<Integrator::Particles>(m);
 
     m.def("simulate", [] (std::size_t nSteps, float dt, int njobs, py::handle progressCallback) {
         System system {};
         auto pool = ctiprd::config::make_pool(njobs);
-        auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+        Integrator integrator {system, pool};
 
         integrator.particles()->initializeParticles(909, "E");
         integrator.particles()->initializeParticles(9091, "S");
 
-        std::vector<std::size_t> nE {};
-        std::vector<std::size_t> nS {};
-        std::vector<std::size_t> nES {};
-        std::vector<std::size_t> nP {};
+        auto counts = integrator.observables().add<Counts>(100, (nSteps + 99) / 100);
+        auto events = integrator.observables().add<Events>(100, nSteps / 100);
         {
             py::gil_scoped_release release;
             for (std::size_t t = 0; t < nSteps; ++t) {
-                if (t % 100 == 0){
-                    std::atomic<std::size_t> nEl {0};
-                    std::atomic<std::size_t> nSl {0};
-                    std::atomic<std::size_t> nESl {0};
-                    std::atomic<std::size_t> nPl {0};
-                    auto futures = integrator.particles()->forEachParticle([&nEl, &nSl, &nESl, &nPl](const auto &id, const auto &, const auto &type,
-                                                                                  const auto &) {
-                        if(type == System::eId) {
-                            ++nEl;
-                        } else if(type == System::sId) {
-                            ++nSl;
-                        } else if(type == System::esId) {
-                            ++nESl;
-                        } else if(type == System::pId) {
-                            ++nPl;
-                        }
-                    }, pool);
-                    for(auto &f : futures) f.wait();
-
-                    nE.emplace_back(nEl.load());
-                    nS.emplace_back(nSl.load());
-                    nES.emplace_back(nESl.load());
-                    nP.emplace_back(nPl.load());
-                }
-
                 integrator.step(dt);
                 if (t % 200 == 0) {
                     py::gil_scoped_acquire acquire;
@@ -78,6 +57,6 @@ PYBIND11_MODULE(mm_mod, m) {
             }
         }
 
-        return std::make_tuple(nE, nS, nES, nP);
+        return std::make_tuple(counts, events);
     });
 }
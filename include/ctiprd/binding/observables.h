@@ -0,0 +1,86 @@
+/**
+ * @file observables.h
+ * @brief Python access to observables, time series are zero-copy numpy views into the preallocated storage.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <ctiprd/cpu/observables/basic.h>
+#include <ctiprd/cpu/observables/dynamics.h>
+#include <ctiprd/cpu/observables/structure.h>
+
+namespace ctiprd::binding {
+
+namespace py = pybind11;
+
+/**
+ * Read-only view onto the recorded frames of a time series, shaped (nFrames, *frameShape). The view keeps the owner
+ * of the series alive.
+ */
+template<typename T, typename Owner>
+py::array timeSeriesView(const std::shared_ptr<Owner> &owner, const cpu::observables::TimeSeries<T> &series) {
+    std::vector<py::ssize_t> shape {static_cast<py::ssize_t>(series.size())};
+    shape.insert(end(shape), begin(series.frameShape()), end(series.frameShape()));
+
+    py::capsule base(new std::shared_ptr<Owner>(owner), [](void *p) {
+        delete static_cast<std::shared_ptr<Owner> *>(p);
+    });
+    py::array out(py::dtype::of<T>(), std::move(shape), series.data(), base);
+    py::detail::array_proxy(out.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+    return out;
+}
+
+template<typename T, typename Owner>
+py::array timeSeriesSteps(const std::shared_ptr<Owner> &owner, const cpu::observables::TimeSeries<T> &series) {
+    py::capsule base(new std::shared_ptr<Owner>(owner), [](void *p) {
+        delete static_cast<std::shared_ptr<Owner> *>(p);
+    });
+    py::array out(py::dtype::of<std::uint64_t>(), {static_cast<py::ssize_t>(series.size())}, series.steps(), base);
+    py::detail::array_proxy(out.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+    return out;
+}
+
+/**
+ * Exports an observable with `stride`, `steps` and `data` properties.
+ */
+template<typename Observable>
+auto exportObservable(py::module_ &module, const std::string &name) {
+    using Base = typename Observable::Base;
+    return py::class_<Observable, Base, std::shared_ptr<Observable>>(module, name.c_str())
+            .def_property_readonly("stride", &Observable::stride)
+            .def_property_readonly("steps", [](const std::shared_ptr<Observable> &self) {
+                return timeSeriesSteps(self, self->series());
+            })
+            .def_property_readonly("data", [](const std::shared_ptr<Observable> &self) {
+                return timeSeriesView(self, self->series());
+            });
+}
+
+template<typename Particles, typename Pool = config::ThreadPool>
+void exportObservables(py::module_ &module) {
+    py::class_<cpu::observables::Observable<Particles, Pool>,
+               std::shared_ptr<cpu::observables::Observable<Particles, Pool>>>(module, "Observable");
+    exportObservable<cpu::observables::ParticleCounts<Particles, Pool>>(module, "ParticleCounts");
+    exportObservable<cpu::observables::ReactionCounts<Particles, Pool>>(module, "ReactionCounts");
+    exportObservable<cpu::observables::PotentialEnergy<Particles, Pool>>(module, "PotentialEnergy");
+    exportObservable<cpu::observables::PositionHistogram<Particles, Pool>>(module, "PositionHistogram");
+    exportObservable<cpu::observables::DensityGrid<Particles, Pool>>(module, "DensityGrid")
+            .def("cell_centers", &cpu::observables::DensityGrid<Particles, Pool>::cellCenters, py::arg("axis"));
+    exportObservable<cpu::observables::RadialDistribution<Particles, Pool>>(module, "RadialDistribution")
+            .def_property_readonly("radii", &cpu::observables::RadialDistribution<Particles, Pool>::radii);
+    exportObservable<cpu::observables::StructureFactor<Particles, Pool>>(module, "StructureFactor")
+            .def_property_readonly("wavenumbers", &cpu::observables::StructureFactor<Particles, Pool>::wavenumbers);
+    if constexpr(Particles::containsImages() || !Particles::SystemType::periodic) {
+        exportObservable<cpu::observables::MeanSquaredDisplacement<Particles, Pool>>(module, "MeanSquaredDisplacement")
+                .def_property_readonly("lags", &cpu::observables::MeanSquaredDisplacement<Particles, Pool>::lags);
+    }
+}
+
+}
@@ -0,0 +1,176 @@
+/**
+ * @file particles.h
+ * @brief Python access to the live particle state, buffers are exposed as zero-copy numpy views.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <ctiprd/config.h>
+#include <ctiprd/systems/util.h>
+
+namespace ctiprd::binding {
+
+namespace py = pybind11;
+
+namespace detail {
+
+/**
+ * Views a buffer of the collection, the view keeps the collection alive.
+ */
+template<typename Particles>
+py::array particleView(const std::shared_ptr<Particles> &particles, const py::dtype &dtype,
+                       std::vector<py::ssize_t> shape, std::vector<py::ssize_t> strides, const void *ptr,
+                       bool writeable) {
+    py::capsule base(new std::shared_ptr<Particles>(particles), [](void *p) {
+        delete static_cast<std::shared_ptr<Particles> *>(p);
+    });
+    // the buffers belong to a non-const collection, handing out a mutable pointer is fine
+    py::array out(dtype, std::move(shape), std::move(strides), const_cast<void *>(ptr), base);
+    if (!writeable) {
+        py::detail::array_proxy(out.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+    }
+    return out;
+}
+
+/**
+ * Views a per-slot buffer of DIM components of type T as (nSlots, DIM) array, the components of a slot start offset
+ * bytes into its element.
+ */
+template<typename T, typename Particles, typename Element>
+py::array vectorView(const std::shared_ptr<Particles> &particles, const std::vector<Element> &buffer,
+                     py::ssize_t offset, bool writeable) {
+    const auto nSlots = static_cast<py::ssize_t>(buffer.size());
+    const auto *first = buffer.empty() ? nullptr : reinterpret_cast<const char *>(buffer.data()) + offset;
+    return particleView(particles, py::dtype::of<T>(), {nSlots, static_cast<py::ssize_t>(Particles::DIM)},
+                        {static_cast<py::ssize_t>(sizeof(Element)), static_cast<py::ssize_t>(sizeof(T))}, first,
+                        writeable);
+}
+
+/**
+ * Byte offset of the value inside an engaged optional position, so that positions can be viewed with the stride of
+ * the optional.
+ */
+template<typename Particles>
+py::ssize_t positionOffset() {
+    const typename Particles::MaybePosition probe {typename Particles::Position{}};
+    return reinterpret_cast<const char *>(&*probe) - reinterpret_cast<const char *>(&probe);
+}
+
+}
+
+/**
+ * Adds particles from an (N, DIM) array in bulk, see ParticleCollection::addParticles. The GIL is released while
+ * copying.
+ *
+ * @param particles the collection
+ * @param positions the positions
+ * @param types one type per position, or a single type for all of them
+ * @param pool optional pool to copy with
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+void addParticles(Particles &particles, const py::array &positions, std::span<const std::size_t> types,
+                  config::PoolPtr<Pool> pool = nullptr) {
+    using Position = typename Particles::Position;
+    static_assert(sizeof(Position) == Particles::DIM * sizeof(typename Particles::dtype),
+                  "Rows of the position array are reinterpreted as positions.");
+    // no copy if the array already is C-contiguous and of the right dtype
+    const auto array = py::array_t<typename Particles::dtype, py::array::c_style | py::array::forcecast>::ensure(
+            positions);
+    if (!array || array.ndim() != 2 || array.shape(1) != static_cast<py::ssize_t>(Particles::DIM)) {
+        throw std::invalid_argument(fmt::format("Positions need to be of shape (N, {}).", Particles::DIM));
+    }
+    std::span<const Position> rows {reinterpret_cast<const Position *>(array.data()),
+                                    static_cast<std::size_t>(array.shape(0))};
+    py::gil_scoped_release release;
+    particles.addParticles(rows, types, pool);
+}
+
+template<typename Particles, typename Pool = config::ThreadPool>
+void addParticles(Particles &particles, const py::array &positions, std::string_view type,
+                  config::PoolPtr<Pool> pool = nullptr) {
+    const std::array<std::size_t, 1> types {
+            systems::particleTypeId<Particles::SystemType::types>(type)
+    };
+    addParticles(particles, positions, std::span<const std::size_t>{types}, pool);
+}
+
+/**
+ * Exports a particle collection. Arrays cover all slots of the collection including blank ones (see `occupied`) and
+ * are views into its buffers, they are invalidated as soon as the collection grows or is compacted. Writing through
+ * a writeable view bypasses periodic wrapping, positions have to stay inside the box.
+ */
+template<typename Particles>
+void exportParticles(py::module_ &module, const std::string &name = "Particles") {
+    using dtype = typename Particles::dtype;
+    using Ptr = std::shared_ptr<Particles>;
+    using TypeArray = py::array_t<std::size_t, py::array::c_style | py::array::forcecast>;
+
+    auto clazz = py::class_<Particles, Ptr>(module, name.c_str())
+            .def_property_readonly("n_particles", &Particles::nParticles)
+            .def_property_readonly("n_slots", &Particles::size)
+            .def("positions", [](const Ptr &self, bool writeable) {
+                return detail::vectorView<dtype>(self, self->positions(), detail::positionOffset<Particles>(),
+                                                 writeable);
+            }, py::arg("writeable") = false)
+            .def("types", [](const Ptr &self, bool writeable) {
+                using ParticleType = typename Particles::ParticleType;
+                const auto &types = self->types();
+                return detail::particleView(self, py::dtype::of<ParticleType>(),
+                                            {static_cast<py::ssize_t>(types.size())},
+                                            {static_cast<py::ssize_t>(sizeof(ParticleType))},
+                                            types.empty() ? nullptr : types.data(), writeable);
+            }, py::arg("writeable") = false)
+            .def("occupied", [](const Ptr &self) {
+                // engagement flags of the optionals are not portably addressable, so this one is a copy
+                py::array_t<bool> out (static_cast<py::ssize_t>(self->size()));
+                auto *mask = out.mutable_data();
+                for (std::size_t i = 0; i < self->size(); ++i) {
+                    mask[i] = self->exists(i);
+                }
+                return out;
+            })
+            .def("add_particles", [](const Ptr &self, const py::array &positions,
+                                     const std::optional<TypeArray> &types, const std::optional<std::string> &type) {
+                if (types.has_value() == type.has_value()) {
+                    throw std::invalid_argument("Either an array of types or a single type name is required.");
+                }
+                if (types) {
+                    std::span<const std::size_t> typeIds {types->data(), static_cast<std::size_t>(types->size())};
+                    addParticles(*self, positions, typeIds);
+                } else {
+                    addParticles(*self, positions, std::string_view{*type});
+                }
+            }, py::arg("positions"), py::arg("types") = py::none(), py::arg("type") = py::none());
+    if constexpr(Particles::containsForces()) {
+        clazz.def("forces", [](const Ptr &self, bool writeable) {
+            return detail::vectorView<dtype>(self, self->forces(), 0, writeable);
+        }, py::arg("writeable") = false);
+    }
+    if constexpr(Particles::containsVelocities()) {
+        clazz.def("velocities", [](const Ptr &self, bool writeable) {
+            return detail::vectorView<dtype>(self, self->velocities(), 0, writeable);
+        }, py::arg("writeable") = false);
+    }
+    if constexpr(Particles::containsImages()) {
+        clazz.def("images", [](const Ptr &self, bool writeable) {
+            return detail::vectorView<typename Particles::Image::value_type>(self, self->images(), 0, writeable);
+        }, py::arg("writeable") = false);
+    }
+}
+
+}
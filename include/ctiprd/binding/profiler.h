@@ -0,0 +1,67 @@
+/**
+ * @file profiler.h
+ * @brief Python access to the per-phase step profile and the task trace.
+ */
+#pragma once
+
+#include <string>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <ctiprd/util/Profiler.h>
+#include <ctiprd/util/Trace.h>
+
+namespace ctiprd::binding {
+
+namespace py = pybind11;
+
+inline void exportProfile(py::module_ &module) {
+    py::class_<util::Profile>(module, "Profile", py::module_local())
+            .def_property_readonly_static("enabled", [](const py::object &) { return util::profiling; })
+            .def_property_readonly("seconds", [](const util::Profile &self) {
+                py::dict out;
+                for (std::size_t i = 0; i < util::nPhases; ++i) {
+                    out[util::phaseNames[i]] = self.seconds[i];
+                }
+                return out;
+            })
+            .def_property_readonly("calls", [](const util::Profile &self) {
+                py::dict out;
+                for (std::size_t i = 0; i < util::nPhases; ++i) {
+                    out[util::phaseNames[i]] = self.calls[i];
+                }
+                return out;
+            })
+            .def_property_readonly("counts", [](const util::Profile &self) {
+                py::dict out;
+                for (std::size_t i = 0; i < util::nCounters; ++i) {
+                    out[util::counterNames[i]] = self.counts[i];
+                }
+                return out;
+            })
+            .def_readonly("hardware_available", &util::Profile::hardwareAvailable)
+            .def_property_readonly("hardware", [](const util::Profile &self) {
+                py::dict out;
+                for (std::size_t i = 0; i < util::nPhases; ++i) {
+                    py::dict events;
+                    for (std::size_t e = 0; e < util::perf::nEvents; ++e) {
+                        events[util::perf::eventNames[e]] = self.hardware[i][e];
+                    }
+                    out[util::phaseNames[i]] = events;
+                }
+                return out;
+            });
+}
+
+inline void exportTrace(py::module_ &module) {
+    module.attr("tracing_enabled") = util::trace::tracing;
+    module.def("write_trace", [](const std::string &path) {
+        util::trace::Tracer::instance().write(path);
+    }, py::arg("path"), "Writes the buffered task timelines as Chrome trace JSON.");
+    module.def("clear_trace", []() {
+        util::trace::Tracer::instance().clear();
+    });
+}
+
+}
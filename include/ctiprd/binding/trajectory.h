@@ -52,7 +52,7 @@ public:
         auto futures = integrator.particles()->forEachParticle([&trajBegin, &typesBegin](auto particleId, const auto &pos, const auto& type, const auto &) {
             typesBegin[particleId] = type;
             for (uint32_t i = 0; i < System::DIM; ++i) {
-                trajBegin[System::DIM * particleId + i] = pos[0];
+                trajBegin[System::DIM * particleId + i] = pos[i];
             }
         }, pool);
         for(auto &future : futures) {
@@ -0,0 +1,149 @@
+/**
+ * @file trajectory_file.h
+ * @brief Python access to trajectory files, frames are zero-copy numpy views into a memory mapping.
+ */
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <ctiprd/io/TrajectoryReader.h>
+
+namespace ctiprd::binding {
+
+namespace py = pybind11;
+
+/**
+ * Python facing trajectory file. Arrays handed out are read-only views into the mapping and keep it alive, so they
+ * stay valid after the TrajectoryFile itself has been garbage-collected.
+ */
+class TrajectoryFile {
+public:
+    explicit TrajectoryFile(const std::string &path) : reader(std::make_shared<io::TrajectoryReader>(path)) {}
+
+    [[nodiscard]] std::size_t nFrames() const {
+        return reader->nFrames();
+    }
+
+    [[nodiscard]] const io::FileHeader &header() const {
+        return reader->header();
+    }
+
+    [[nodiscard]] py::array steps() const {
+        const auto index = reader->index();
+        const auto stride = static_cast<py::ssize_t>(sizeof(io::FrameIndexEntry));
+        return view(py::dtype::of<std::uint64_t>(), {static_cast<py::ssize_t>(index.size())}, {stride},
+                    index.empty() ? nullptr : &index.front().step);
+    }
+
+    /**
+     * Views a frame.
+     *
+     * @param k the frame index, negative values count from the end
+     * @param type optionally restrict the frame to one particle type
+     * @return tuple of (positions, types, counts per type)
+     */
+    [[nodiscard]] py::tuple frame(std::int64_t k, std::optional<std::size_t> type) const {
+        const auto frameView = reader->frame(normalize(k));
+        const auto &hdr = header();
+
+        std::uint64_t first {0};
+        std::uint64_t n {frameView.nParticles};
+        if (type) {
+            if (*type >= hdr.nTypes) {
+                throw py::index_error(fmt::format("Particle type {} out of range for {} types.", *type, hdr.nTypes));
+            }
+            first = frameView.typeOffset(*type);
+            n = frameView.counts[*type];
+        }
+
+        const auto nRows = static_cast<py::ssize_t>(n);
+        const auto dim = static_cast<py::ssize_t>(hdr.dim);
+        const auto dtypeSize = static_cast<py::ssize_t>(hdr.dtypeSize);
+        const auto typeSize = static_cast<py::ssize_t>(hdr.typeSize);
+
+        auto positions = view(py::dtype(fmt::format("f{}", hdr.dtypeSize)), {nRows, dim}, {dim * dtypeSize, dtypeSize},
+                              frameView.positions + first * hdr.dim * hdr.dtypeSize);
+        auto types = view(py::dtype(fmt::format("u{}", hdr.typeSize)), {nRows}, {typeSize},
+                          frameView.types + first * hdr.typeSize);
+        auto counts = view(py::dtype::of<std::uint64_t>(), {static_cast<py::ssize_t>(hdr.nTypes)},
+                           {static_cast<py::ssize_t>(sizeof(std::uint64_t))}, frameView.counts.data());
+        return py::make_tuple(positions, types, counts);
+    }
+
+    /**
+     * Views all frames with stepBegin <= step < stepEnd.
+     */
+    [[nodiscard]] py::list frames(std::uint64_t stepBegin, std::uint64_t stepEnd,
+                                  std::optional<std::size_t> type) const {
+        const auto [first, last] = reader->frameRange(stepBegin, stepEnd);
+        py::list out;
+        for (auto k = first; k < last; ++k) {
+            out.append(frame(static_cast<std::int64_t>(k), type));
+        }
+        return out;
+    }
+
+    [[nodiscard]] py::list slice(const py::slice &s) const {
+        py::ssize_t start, stop, step, length;
+        if (!s.compute(static_cast<py::ssize_t>(nFrames()), &start, &stop, &step, &length)) {
+            throw py::error_already_set();
+        }
+        py::list out;
+        for (py::ssize_t i = 0; i < length; ++i) {
+            out.append(frame(start + i * step, std::nullopt));
+        }
+        return out;
+    }
+
+private:
+    [[nodiscard]] std::size_t normalize(std::int64_t k) const {
+        if (k < 0) {
+            k += static_cast<std::int64_t>(nFrames());
+        }
+        if (k < 0 || static_cast<std::size_t>(k) >= nFrames()) {
+            throw py::index_error(fmt::format("Frame {} out of range for {} frames.", k, nFrames()));
+        }
+        return static_cast<std::size_t>(k);
+    }
+
+    [[nodiscard]] py::array view(const py::dtype &dtype, std::vector<py::ssize_t> shape,
+                                 std::vector<py::ssize_t> strides, const void *ptr) const {
+        // the capsule holds a reference to the mapping for as long as numpy holds on to the array
+        py::capsule base(new std::shared_ptr<io::TrajectoryReader>(reader), [](void *p) {
+            delete static_cast<std::shared_ptr<io::TrajectoryReader> *>(p);
+        });
+        py::array out(dtype, std::move(shape), std::move(strides), ptr, base);
+        py::detail::array_proxy(out.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+        return out;
+    }
+
+    std::shared_ptr<io::TrajectoryReader> reader;
+};
+
+inline void exportTrajectoryFile(py::module_ &module) {
+    py::class_<TrajectoryFile>(module, "TrajectoryFile", py::module_local())
+            .def(py::init<std::string>(), py::arg("path"))
+            .def_property_readonly("n_frames", &TrajectoryFile::nFrames)
+            .def_property_readonly("steps", &TrajectoryFile::steps)
+            .def_property_readonly("dim", [](const TrajectoryFile &self) { return self.header().dim; })
+            .def_property_readonly("n_types", [](const TrajectoryFile &self) { return self.header().nTypes; })
+            .def("frame", &TrajectoryFile::frame, py::arg("k"), py::arg("type") = py::none())
+            .def("frames", &TrajectoryFile::frames, py::arg("step_begin"), py::arg("step_end"),
+                 py::arg("type") = py::none())
+            .def("__len__", &TrajectoryFile::nFrames)
+            .def("__getitem__", [](const TrajectoryFile &self, std::int64_t k) {
+                return self.frame(k, std::nullopt);
+            })
+            .def("__getitem__", &TrajectoryFile::slice);
+}
+
+}
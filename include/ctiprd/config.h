@@ -3,6 +3,7 @@
 //
 #pragma once
 
+#include <algorithm>
 #include <thread>
 #include <random>
 #include <memory>
@@ -27,8 +28,29 @@ static auto make_pool(int n) {
 
 template<typename Pool>
 auto threadGranularity(PoolPtr<Pool> pool) {
-    static auto res = 2 * pool->size();
-    return res;
+    return 2 * pool->size();
 }
 
+/**
+ * Maps item indices to the index of the task visiting them when a range is split into threadGranularity tasks, as
+ * done by ParticleCollection::forEachParticle and NeighborList::forEachCell. Tasks can then accumulate into per-task
+ * slots without synchronization.
+ */
+struct TaskPartition {
+    std::size_t grainSize {0};
+    std::size_t nTasks {1};
+
+    [[nodiscard]] std::size_t operator()(std::size_t index) const {
+        return grainSize == 0 ? nTasks - 1 : std::min(index / grainSize, nTasks - 1);
+    }
+};
+
+/**
+ * Per-task accumulator, aligned to a cache line so that concurrently written slots do not share one.
+ */
+template<typename T>
+struct alignas(64) TaskSlot {
+    T value {};
+};
+
 }
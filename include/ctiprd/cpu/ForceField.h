@@ -8,13 +8,18 @@
  */
 #pragma once
 
+#include <span>
 #include <tuple>
+#include <vector>
 
 #include <ctiprd/potentials/util.h>
 #include <ctiprd/potentials/external.h>
 #include <ctiprd/potentials/interaction.h>
 
-#include <ctiprd/cpu/NeighborList.h>
+#include <ctiprd/cpu/MultiResolutionNeighborList.h>
+#include <ctiprd/cpu/ParticleCollection.h>
+#include <ctiprd/cpu/SubdivisionTuner.h>
+#include <ctiprd/util/Profiler.h>
 
 #include "reactions.h"
 #include "forces.h"
@@ -30,66 +35,114 @@ struct ForceField {
 
     static constexpr int nExternalPotentials = std::tuple_size_v<ExternalPotentials>;
     static constexpr int nPairPotentials = std::tuple_size_v<PairPotentials>;
-    using NeighborList = nl::NeighborList<DIM, System::periodic, dtype>;
-
+    using NeighborLists = nl::MultiResolutionNeighborList<DIM, System::periodic, dtype, false>;
+
+    /**
+     * Evaluates the forces on all particles.
+     *
+     * @param particles the particles
+     * @param pool the thread pool
+     * @param wait whether to wait for the sweep to finish
+     * @param energies if not empty, one slot per forEachParticle task into which the potential energy is accumulated
+     * @param profiler optional profiler, the evaluation is only timed when waiting for it
+     */
     template<typename Particles, typename Pool>
-    void forces(std::shared_ptr<Particles> particles, std::shared_ptr<Pool> pool, bool wait = true) {
+    void forces(std::shared_ptr<Particles> particles, std::shared_ptr<Pool> pool, bool wait = true,
+                std::span<config::TaskSlot<dtype>> energies = {}, util::Profiler *profiler = nullptr) {
         if constexpr(nPairPotentials > 0) {
-            neighborList_->update(particles.get(), pool);
+            if (wait) {
+                subdivisionTuner.begin(neighborLists_, particles->nParticles());
+            }
+            const util::Profiler::Scope scope {profiler, util::Phase::forceNeighborList};
+            neighborLists_.update(particles.get(), pool);
         }
 
         if constexpr(nExternalPotentials > 0 || nPairPotentials > 0) {
             const auto worker = [
                     &pot = potentialsO1,
                     &potPair = potentialsO2,
-                    nl = neighborList_.get(),
-                    &data = *particles
+                    &nls = neighborLists_,
+                    &data = *particles,
+                    energies,
+                    partition = particles->taskPartition(pool)
             ]
                     (const auto &particleId, typename Particles::Position &pos, const typename Particles::ParticleType &type,
                      typename Particles::Force &force) {
 
+                dtype energy {0};
                 std::fill(begin(force.data), end(force.data), static_cast<dtype>(0));
                 for(const auto &potentialO1 : pot[type]) {
                     force += potentialO1->force(pos);
+                    if (!energies.empty()) {
+                        energy += potentialO1->energy(pos);
+                    }
                 }
 
                 if constexpr(nPairPotentials > 0) {
-                    if(nl->isAllowedType(type)) {
-                        nl->forEachNeighbor(particleId, data, [&pos, &type, &force, &potPair](auto neighborId, const auto &neighborPos,
-                                                                                              const auto &neighborType,
-                                                                                              const auto &neighborForce) {
-                            for(const auto &potentialO2 : potPair[std::tie(type, neighborType)]) {
-                                force += potentialO2->force(pos, neighborPos);
-                            }
-                        });
+                    // each neighbor list evaluates the type pairs cut off at its radius
+                    for (std::size_t c = 0; c < nls.size(); ++c) {
+                        const auto &nl = nls.grid(c);
+                        if(nl.isAllowedType(type)) {
+                            nl.forEachNeighbor(particleId, data, [&nls, c, &pos, &type, &force, &potPair, &energy,
+                                                                  energies](
+                                    auto neighborId, const auto &neighborPos, const auto &neighborType,
+                                    const auto &neighborForce) {
+                                if (nls.classOf(type, neighborType) != c) {
+                                    return;
+                                }
+                                for(const auto &potentialO2 : potPair[std::tie(type, neighborType)]) {
+                                    force += potentialO2->force(pos, neighborPos);
+                                    if (!energies.empty()) {
+                                        // every pair is visited from both sides
+                                        energy += potentialO2->energy(pos, neighborPos) / 2;
+                                    }
+                                }
+                            });
+                        }
                     }
                 }
+
+                if (!energies.empty()) {
+                    energies[partition(particleId)].value += energy;
+                }
             };
+            const util::Profiler::Scope scope {wait ? profiler : nullptr, util::Phase::forces};
             auto futures = particles->forEachParticle(worker, pool);
             if (wait) {
                 for(auto &future : futures)  {
                     future.wait();
                 }
+                if constexpr(nPairPotentials > 0) {
+                    subdivisionTuner.end(neighborLists_);
+                }
             }
         }
     }
 
-    explicit ForceField(const System &system) {
+    /**
+     * @param system the system
+     * @param mergeFactor ratio of pair potential cutoffs up to which type pairs share a neighbor list
+     */
+    explicit ForceField(const System &system, dtype mergeFactor = NeighborLists::defaultMergeFactor) {
         std::tie(potentialsO1, backingO1) = forces::generateMapO1<ParticleCollection>(system);
         std::tie(potentialsO2, backingO2) = forces::generateMapO2<ParticleCollection>(system);
 
         if constexpr(nPairPotentials > 0) {
-            auto cutoff = ctiprd::potentials::cutoff<dtype>(system.pairPotentials);
-            neighborList_ = std::make_unique<NeighborList>(System::boxSize, cutoff);
-
-            std::unordered_set<std::size_t> neighborListTypes{};
-            for (const auto &reactionElement: potentialsO2) {
-                if (!reactionElement.second.empty()) {
-                    neighborListTypes.emplace(std::get<0>(reactionElement.first));
-                    neighborListTypes.emplace(std::get<1>(reactionElement.first));
-                }
-            }
-            neighborList_->setTypes(neighborListTypes);
+            std::vector<typename NeighborLists::PairRadius> cutoffs;
+            std::apply([&cutoffs](const auto &... potentials) {
+                ([&cutoffs](const auto &potential) {
+                    for (const auto &[name1, d1] : System::types) {
+                        const auto id1 = ctiprd::systems::particleTypeId<System::types>(name1);
+                        for (const auto &[name2, d2] : System::types) {
+                            const auto id2 = ctiprd::systems::particleTypeId<System::types>(name2);
+                            if (potential.supportsTypes(id1, id2)) {
+                                cutoffs.push_back({id1, id2, potential.cutoff});
+                            }
+                        }
+                    }
+                }(potentials), ...);
+            }, system.pairPotentials);
+            neighborLists_ = NeighborLists(System::boxSize, std::move(cutoffs), mergeFactor);
         }
     }
 
@@ -98,7 +151,9 @@ struct ForceField {
     forces::FFO2Map<ParticleCollection> potentialsO2;
     forces::FFO2Backing<ParticleCollection> backingO2;
 
-    std::unique_ptr<NeighborList> neighborList_;
+    NeighborLists neighborLists_;
+    // only samples evaluations which are waited for
+    nl::SubdivisionTuner subdivisionTuner;
 
 };
 
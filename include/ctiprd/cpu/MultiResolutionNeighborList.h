@@ -0,0 +1,176 @@
+/**
+ * @file MultiResolutionNeighborList.h
+ * @brief Neighbor search with one cell grid per class of interaction radii, each holding only the particle types
+ * which interact at that radius.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#include <ctiprd/cpu/NeighborList.h>
+
+namespace ctiprd::cpu::nl {
+
+/**
+ * Groups the interacting type pairs by their radius and keeps one NeighborList per group. Going down from the
+ * largest radius, a pair joins the current group while its radius is at least 1 / mergeFactor of the group's radius,
+ * otherwise it opens a new group. Each grid is built at its group's radius and only stores the types of its pairs.
+ *
+ * A type pair belongs to exactly one group, so a traversal of group c has to skip pairs with classOf(t1, t2) != c;
+ * those are found in their own group's grid.
+ *
+ * @tparam DIM dimension
+ * @tparam periodic whether the box is periodic
+ * @tparam dtype the scalar type
+ * @tparam allTypes whether the grids store every type, in which case they only differ in their cell size
+ */
+template<int DIM, bool periodic, typename dtype, bool allTypes=false>
+class MultiResolutionNeighborList {
+public:
+    using Grid = NeighborList<DIM, periodic, dtype, allTypes>;
+
+    /**
+     * Interaction radius of a type pair, the pair is unordered.
+     */
+    struct PairRadius {
+        std::size_t type1 {};
+        std::size_t type2 {};
+        dtype radius {};
+    };
+
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * Radii within this factor of each other share a grid. A shared grid is cut at the larger radius, which costs at
+     * most mergeFactor^DIM as many candidate pairs for the smaller one, but saves an update per step.
+     */
+    static constexpr dtype defaultMergeFactor = 2;
+
+    MultiResolutionNeighborList() = default;
+
+    /**
+     * @param gridSize extent of the origin-centered box
+     * @param pairRadii radii of the interacting type pairs, multiple entries of a pair are reduced to their maximum
+     * and pairs without a positive radius are dropped
+     * @param mergeFactor ratio of radii up to which pairs share a grid, at least one
+     * @param nSubdivides amount of fine-graining of each grid
+     */
+    MultiResolutionNeighborList(std::array<dtype, DIM> gridSize, std::vector<PairRadius> pairRadii,
+                                dtype mergeFactor = defaultMergeFactor, int nSubdivides = 2) {
+        if (mergeFactor < 1) {
+            throw std::invalid_argument("merge factor must be at least one.");
+        }
+        pairRadii.erase(std::remove_if(begin(pairRadii), end(pairRadii), [](const auto &pair) {
+            return !(pair.radius > 0);
+        }), end(pairRadii));
+        for (const auto &pair : pairRadii) {
+            nTypes = std::max(nTypes, std::max(pair.type1, pair.type2) + 1);
+        }
+        // largest radius first, so that a pair's group is known once its largest entry is seen
+        std::sort(begin(pairRadii), end(pairRadii), [](const auto &a, const auto &b) { return a.radius > b.radius; });
+
+        classes.assign(nTypes * nTypes, none);
+        std::vector<std::unordered_set<std::size_t>> types;
+        for (const auto &pair : pairRadii) {
+            if (classOf(pair.type1, pair.type2) != none) {
+                continue;
+            }
+            if (radii.empty() || pair.radius * mergeFactor < radii.back()) {
+                radii.push_back(pair.radius);
+                types.emplace_back();
+            }
+            classes[pair.type1 * nTypes + pair.type2] = radii.size() - 1;
+            classes[pair.type2 * nTypes + pair.type1] = radii.size() - 1;
+            types.back().insert(pair.type1);
+            types.back().insert(pair.type2);
+        }
+
+        grids.reserve(radii.size());
+        for (std::size_t c = 0; c < radii.size(); ++c) {
+            grids.push_back(std::make_unique<Grid>(gridSize, radii[c], nSubdivides));
+            grids.back()->setTypes(types[c]);
+        }
+    }
+
+    /**
+     * Number of grids.
+     */
+    [[nodiscard]] std::size_t size() const {
+        return grids.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return grids.empty();
+    }
+
+    Grid &grid(std::size_t c) {
+        return *grids[c];
+    }
+
+    const Grid &grid(std::size_t c) const {
+        return *grids[c];
+    }
+
+    /**
+     * The radius grid c was built at, the largest radius of its pairs.
+     */
+    [[nodiscard]] dtype radius(std::size_t c) const {
+        return radii[c];
+    }
+
+    /**
+     * The grid whose traversal is responsible for a type pair, none if the types do not interact.
+     */
+    [[nodiscard]] std::size_t classOf(std::size_t type1, std::size_t type2) const {
+        if (type1 >= nTypes || type2 >= nTypes) {
+            return none;
+        }
+        return classes[type1 * nTypes + type2];
+    }
+
+    template<typename ParticleCollection, typename Pool>
+    void update(ParticleCollection *collection, std::shared_ptr<Pool> pool) {
+        for (auto &grid : grids) {
+            grid->update(collection, pool);
+        }
+    }
+
+    /**
+     * Rebuilds all grids with the same number of cells per radius, see NeighborList::setSubdivides.
+     */
+    void setSubdivides(int nSubdivides) {
+        for (auto &grid : grids) {
+            grid->setSubdivides(nSubdivides);
+        }
+    }
+
+    [[nodiscard]] int nSubdivides() const {
+        return grids.empty() ? 0 : grids.front()->nSubdivides();
+    }
+
+    /**
+     * Adjacency table entries of all grids if they were built with nSubdivides.
+     */
+    [[nodiscard]] std::size_t adjacencyEntries(int nSubdivides) const {
+        std::size_t entries {0};
+        for (const auto &grid : grids) {
+            entries += grid->adjacencyEntries(nSubdivides);
+        }
+        return entries;
+    }
+
+private:
+    std::vector<std::unique_ptr<Grid>> grids;
+    std::vector<dtype> radii;
+    std::size_t nTypes {0};
+    std::vector<std::size_t> classes;
+};
+
+}
@@ -9,12 +9,19 @@
 #include <thread>
 #include <unordered_set>
 #include <type_traits>
+#include <array>
+#include <cmath>
+#include <vector>
 
 #include <ctiprd/config.h>
 #include <ctiprd/util/ops.h>
 #include <ctiprd/util/Index.h>
+#include <ctiprd/util/PerfCounters.h>
+#include <ctiprd/util/Trace.h>
 #include <ctiprd/thread/utils.h>
 
+#include <tsl/robin_map.h>
+
 namespace ctiprd::cpu::nl {
 
 /**
@@ -151,6 +158,53 @@ struct CellAdjacency {
     std::vector<std::size_t> cellNeighborsContent{};
 };
 
+namespace detail {
+/**
+ * Contiguous per-axis coordinate storage of the particles within a (neighborhood of) cell(s), used for screening.
+ */
+template<typename dtype, std::size_t DIM>
+struct ScreeningBuffer {
+    std::vector<std::size_t> ids;
+    std::array<std::vector<dtype>, DIM> coordinates;
+    std::vector<dtype> distances;
+
+    void clear() {
+        ids.clear();
+        for (auto &axis : coordinates) {
+            axis.clear();
+        }
+    }
+
+    template<typename Position>
+    void push(std::size_t id, const Position &pos) {
+        ids.push_back(id);
+        for (std::size_t d = 0; d < DIM; ++d) {
+            coordinates[d].push_back(pos[d]);
+        }
+    }
+};
+}
+
+/**
+ * How the cells of a NeighborList are stored. Dense grids keep a head per cell, see Adjacency for how they find
+ * adjacent cells. Sparse grids only keep the occupied cells in a hash map and compute adjacent cells on the fly from the cell's
+ * multi-index, so that memory scales with the number of particles instead of the box volume. Automatic picks the
+ * sparse grid for large grids with many more cells than particles.
+ */
+enum class CellGrid {
+    automatic, dense, sparse
+};
+
+/**
+ * How dense grids find the cells adjacent to a cell. Tables store them for every cell, i.e., (2 * nSubdivides + 1)^DIM
+ * indices per cell. Stencils only store that many flat index offsets, which are added to the cell's own index in the
+ * interior of the grid, cells at the boundary are wrapped around or clipped along each axis. Automatic uses a table as
+ * long as it is small.
+ */
+enum class Adjacency {
+    automatic, table, stencil
+};
+
 /**
  * A cell linked-list.
  *
@@ -165,7 +219,31 @@ public:
     /**
      * Index type which is used to access cells as spatial (i, j, k,...) indices or flat (ravel/unravel).
      */
-    using Index = util::Index<DIM, std::array<std::int32_t, DIM>>;
+    using Index = util::Index<DIM, std::array<std::int64_t, DIM>>;
+
+    /**
+     * Automatic grids only become sparse from this many cells on, smaller dense grids are cheap.
+     */
+    static constexpr std::size_t minSparseCells = std::size_t{1} << 16;
+    /**
+     * Automatic grids become sparse with more cells than this per particle and dense again with fewer than
+     * denseCellsPerParticle, the gap avoids flipping back and forth.
+     */
+    static constexpr std::size_t sparseCellsPerParticle = 16;
+    static constexpr std::size_t denseCellsPerParticle = 8;
+    /**
+     * Automatic adjacency only builds tables with at most this many entries.
+     */
+    static constexpr std::size_t maxTableEntries = std::size_t{1} << 22;
+    /**
+     * Whether forEachPairInRange uses the gathered screening kernel unless told otherwise, see CTIPRD_SIMD_SCREENING.
+     */
+#ifdef CTIPRD_SIMD_SCREENING
+    static constexpr bool gatheredScreening = true;
+#else
+    static constexpr bool gatheredScreening = false;
+#endif
+
     /**
      * Creates a new CLL based on a grid size (which assumed to result in an origin-centered space), an interaction
      * radius which is used to determine the amount of subdivision and a number of subdivides to further fine-grain
@@ -174,24 +252,19 @@ public:
      * @param gridSize array of dtype describing the extent of space
      * @param interactionRadius maximum radius under which particles can interact
      * @param nSubdivides amount of fine-graining
+     * @param grid how cells are stored, automatic grids decide on every update
      */
-    NeighborList(std::array<dtype, DIM> gridSize, dtype interactionRadius, int nSubdivides = 2)
-        : _gridSize(gridSize) {
-            // determine the number of cells per axis
-            std::array<typename Index::value_type, DIM> nCells;
+    NeighborList(std::array<dtype, DIM> gridSize, dtype interactionRadius, int nSubdivides = 2,
+                 CellGrid grid = CellGrid::automatic)
+        : _gridSize(gridSize), _interactionRadius(interactionRadius), _grid(grid),
+          // automatic grids start out as an empty sparse grid, the first update decides
+          _sparse(grid != CellGrid::dense) {
             for (int i = 0; i < DIM; ++i) {
-                _cellSize[i] = interactionRadius / nSubdivides;
                 if (gridSize[i] <= 0) {
                     throw std::invalid_argument("grid sizes must be positive.");
                 }
-                nCells[i] = gridSize[i] / _cellSize[i];
             }
-            // create index for raveling and unravling operations
-            _index = Index(nCells);
-            // initialize head to reflect the total number of cells
-            head.resize(_index.size());
-            // compute adjacencies among cells and store in arrays
-            _adjacency = CellAdjacency<Index, periodic>{_index, nSubdivides};
+            setSubdivides(nSubdivides);
     }
 
     ~NeighborList() = default;
@@ -201,6 +274,86 @@ public:
     NeighborList(NeighborList&&) noexcept = default;
     NeighborList &operator=(NeighborList&&) noexcept = default;
 
+    /**
+     * Rebuilds the cell grid and adjacency with a different amount of fine-graining. The stored particles are
+     * invalidated, update() needs to be called before the next traversal.
+     *
+     * @param nSubdivides number of cells per interaction radius
+     */
+    void setSubdivides(int nSubdivides) {
+        // determine the number of cells per axis
+        std::array<typename Index::value_type, DIM> nCells;
+        for (int i = 0; i < DIM; ++i) {
+            _cellSize[i] = _interactionRadius / nSubdivides;
+            nCells[i] = _gridSize[i] / _cellSize[i];
+        }
+        _nSubdivides = nSubdivides;
+        // create index for raveling and unravling operations
+        _index = Index(nCells);
+        for (std::size_t d = 0; d < DIM; ++d) {
+            typename Index::GridDims unit {};
+            unit[d] = 1;
+            _strides[d] = _index.index(unit);
+        }
+        buildStencil();
+
+        head.clear();
+        _adjacency = {};
+        _denseBuilt = false;
+        clearSparse();
+        // automatic grids keep their current storage until the next update
+        if (_grid != CellGrid::automatic) {
+            _sparse = _grid == CellGrid::sparse;
+        }
+        if (!_sparse) {
+            buildDense();
+        }
+    }
+
+    [[nodiscard]] int nSubdivides() const {
+        return _nSubdivides;
+    }
+
+    /**
+     * Changes how cells are stored, invalidates the stored particles like setSubdivides.
+     */
+    void setGrid(CellGrid grid) {
+        _grid = grid;
+        setSubdivides(_nSubdivides);
+    }
+
+    /**
+     * Changes how dense grids find adjacent cells, invalidates the stored particles like setSubdivides.
+     */
+    void setAdjacency(Adjacency adjacency) {
+        _adjacencyMode = adjacency;
+        setSubdivides(_nSubdivides);
+    }
+
+    /**
+     * Whether a dense grid uses an adjacency table, otherwise adjacent cells are computed from the stencil.
+     */
+    [[nodiscard]] bool adjacencyTable() const {
+        return _useTable;
+    }
+
+    /**
+     * Whether cells are currently stored sparsely. Traversals then only visit occupied cells, cell indices passed to
+     * and from forEachCell, forEachNeighborInCell and forEachPairInRange enumerate the occupied cells.
+     */
+    [[nodiscard]] bool sparse() const {
+        return _sparse;
+    }
+
+    /**
+     * Number of entries in the adjacency table of this neighbor list if it was built with nSubdivides, an upper
+     * bound for non-periodic boundaries. Zero if it would compute adjacent cells from the stencil instead.
+     */
+    [[nodiscard]] std::size_t adjacencyEntries(int nSubdivides) const {
+        const auto entries = tableEntries(nSubdivides);
+        return useTable(entries) ? entries : 0;
+    }
+
     void setTypes(const std::unordered_set<std::size_t> &allowedTypes) {
         if constexpr(!allTypes) {
             types = allowedTypes;
@@ -216,19 +369,34 @@ public:
     }
 
     /**
-     * Clears the currently stored particle indices and (re)computes the cell linked-list structure.
+     * Clears the currently stored particle indices and (re)computes the cell linked-list structure. Automatic grids
+     * first decide whether to store the cells sparsely based on the number of particles.
      *
-     * @tparam Iterator Type of random-access iterator.
-     * @param begin begin of the data structure containing vectors
-     * @param end end of the data structure containing vectors
-     * @param nJobs number of processes to use, threads are automatically joined
+     * @param collection the particles
+     * @param pool the thread pool
      */
     template<typename ParticleCollection, typename Pool>
     void update(ParticleCollection* collection, std::shared_ptr<Pool> pool) {
+        if (_grid == CellGrid::automatic) {
+            const auto nCells = static_cast<std::size_t>(_index.size());
+            const auto nParticles = std::max<std::size_t>(collection->nParticles(), 1);
+            const auto cellsPerParticle = _sparse ? denseCellsPerParticle : sparseCellsPerParticle;
+            _sparse = nCells >= minSparseCells && nCells > cellsPerParticle * nParticles;
+            if (!_sparse && !_denseBuilt) {
+                buildDense();
+            }
+        }
+
         // add artificial empty particle so that all entries can be unsigned
         list.resize(collection->size() + 1);
         // reset list
         std::fill(std::begin(list), std::end(list), 0);
+
+        if (_sparse) {
+            updateSparse(collection, pool);
+            return;
+        }
+
         // reset head
         std::fill(std::begin(head), std::end(head), thread::copyable_atomic<std::size_t>());
 
@@ -280,7 +448,7 @@ public:
      * @return flat index pointing to a cell
      */
     template<typename Position>
-    std::uint32_t positionToCellIndex(const Position &pos) const {
+    typename Index::value_type positionToCellIndex(const Position &pos) const {
         return _index.index(gridPos(pos));
     }
 
@@ -288,6 +456,8 @@ public:
     std::vector<std::future<void>> forEachCell(F &&func, PoolPtr pool) const {
         std::vector<std::future<void>> futures;
         const auto worker = [operation = std::forward<F>(func)](auto begin, auto end) {
+            const util::trace::TaskScope scope {static_cast<std::size_t>(begin), static_cast<std::size_t>(end)};
+            const util::perf::Scope counters {};
             for(auto i = begin; i != end; ++i) {
                 operation(i);
             }
@@ -305,10 +475,19 @@ public:
     }
 
     /**
-     * The number of cells in this cell linked-list
+     * The partition of cells into tasks used by forEachCell with the same pool.
+     */
+    template<typename PoolPtr>
+    [[nodiscard]] config::TaskPartition taskPartition(PoolPtr pool) const {
+        const auto granularity = static_cast<std::size_t>(config::threadGranularity(pool));
+        return {static_cast<std::size_t>(nCellsTotal()) / granularity, granularity};
+    }
+
+    /**
+     * The number of cells in this cell linked-list which are traversed, only the occupied ones if sparse.
      */
-    auto nCellsTotal() const {
-        return _index.size();
+    typename Index::value_type nCellsTotal() const {
+        return _sparse ? static_cast<typename Index::value_type>(occupiedCells.size()) : _index.size();
     }
 
     template<typename F>
@@ -318,13 +497,17 @@ public:
 
     template<bool all, typename F>
     void forEachNeighborInCell(F &&func, typename Index::value_type cellIndex) const {
-        auto particleId = (*head.at(cellIndex)).load();
+        auto particleId = headOf(cellIndex);
+        if (particleId == 0) {
+            return;
+        }
+        static thread_local std::vector<std::size_t> heads {};
+        heads.clear();
+        forEachAdjacentHead(cellIndex, [](auto neighborHead) { heads.push_back(neighborHead); });
+
         while (particleId != 0) {
-            const auto begin = _adjacency.cellsBegin(cellIndex);
-            const auto end = _adjacency.cellsEnd(cellIndex);
-            for (auto k = begin; k != end; ++k) {
-                const auto neighborCellId = *k;
-                auto neighborId = (*head.at(neighborCellId)).load();
+            for (const auto neighborHead : heads) {
+                auto neighborId = neighborHead;
                 while (neighborId != 0) {
                     if constexpr(all) {
                         if(neighborId != particleId) {
@@ -345,17 +528,36 @@ public:
 
 
 
+    /**
+     * Screens all unique pairs (i, j) with i in the cell given by cellIndex and j in the cell or its adjacent cells
+     * and invokes func(i, j, dSquared) for each pair whose (minimum image) squared distance does not exceed
+     * cutoffSquared. The gathered kernel copies the coordinates of the cell and its neighborhood into contiguous
+     * per-axis buffers and computes the distances of one particle against the whole neighborhood in a single
+     * branch-free, vectorizable loop before the in-range pairs are compacted. The scalar fallback tests pair by pair
+     * while walking the linked list.
+     *
+     * @tparam gathered whether to use the gathered kernel, defaults to gatheredScreening
+     * @param collection the particle collection this neighbor list was updated with
+     * @param cellIndex the flat cell index
+     * @param cutoffSquared the squared cutoff radius
+     * @param func callback for each pair within range
+     */
+    template<bool gathered = gatheredScreening, typename ParticleCollection, typename F>
+    void forEachPairInRange(const ParticleCollection &collection, typename Index::value_type cellIndex,
+                            dtype cutoffSquared, F &&func) const {
+        if constexpr(gathered) {
+            forEachGatheredPairInRange(collection, cellIndex, cutoffSquared, std::forward<F>(func));
+        } else {
+            forEachScalarPairInRange(collection, cellIndex, cutoffSquared, std::forward<F>(func));
+        }
+    }
+
     template<typename ParticleCollection, typename F>
     void forEachNeighbor(std::size_t particleId, ParticleCollection &collection, F &&fun) const {
         const auto &pos = collection.position(particleId);
         const auto gridPos = this->gridPos(&pos[0]);
-        const auto gridId = _index.index(gridPos);
-        const auto begin = _adjacency.cellsBegin(gridId);
-        const auto end = _adjacency.cellsEnd(gridId);
-        for (auto k = begin; k != end; ++k) {
-            const auto neighborCellId = *k;
-
-            auto neighborId = (*head.at(neighborCellId)).load();
+        const auto visit = [this, particleId, &collection, &fun](auto neighborHead) {
+            auto neighborId = neighborHead;
             while (neighborId != 0) {
                 if (neighborId - 1 != particleId) {
                     fun(neighborId - 1, collection.position(neighborId - 1), collection.typeOf(neighborId - 1),
@@ -363,6 +565,14 @@ public:
                 }
                 neighborId = list.at(neighborId);
             }
+        };
+        const auto cellIndex = _index.index(gridPos);
+        if (_sparse) {
+            forEachStencilHead(gridPos, cellIndex, [this](auto cell) { return sparseHeadOf(cell); }, visit);
+        } else if (_useTable) {
+            forEachTableHead(cellIndex, visit);
+        } else {
+            forEachStencilHead(gridPos, cellIndex, [this](auto cell) { return (*head[cell]).load(); }, visit);
         }
     }
 
@@ -371,12 +581,282 @@ public:
     }
 
 private:
+    template<typename ParticleCollection, typename F>
+    void forEachGatheredPairInRange(const ParticleCollection &collection, typename Index::value_type cellIndex,
+                                    dtype cutoffSquared, F &&func) const {
+        static thread_local detail::ScreeningBuffer<dtype, DIM> cell {};
+        static thread_local detail::ScreeningBuffer<dtype, DIM> neighborhood {};
+
+        cell.clear();
+        for (auto particleId = headOf(cellIndex); particleId != 0; particleId = list[particleId]) {
+            cell.push(particleId - 1, collection.positionOf(particleId - 1));
+        }
+        if (cell.ids.empty()) {
+            return;
+        }
+
+        neighborhood.clear();
+        forEachAdjacentHead(cellIndex, [this, &collection](auto neighborHead) {
+            for (auto neighborId = neighborHead; neighborId != 0; neighborId = list[neighborId]) {
+                neighborhood.push(neighborId - 1, collection.positionOf(neighborId - 1));
+            }
+        });
+        const auto nNeighbors = neighborhood.ids.size();
+        neighborhood.distances.resize(nNeighbors);
+
+        for (std::size_t i = 0; i < cell.ids.size(); ++i) {
+            auto* distances = neighborhood.distances.data();
+            std::fill(distances, distances + nNeighbors, static_cast<dtype>(0));
+            for (std::size_t d = 0; d < DIM; ++d) {
+                const auto xi = cell.coordinates[d][i];
+                const auto* xj = neighborhood.coordinates[d].data();
+                const auto boxSize = _gridSize[d];
+                const auto inverseBoxSize = static_cast<dtype>(1) / boxSize;
+                for (std::size_t j = 0; j < nNeighbors; ++j) {
+                    auto dx = xj[j] - xi;
+                    if constexpr(periodic) {
+                        dx -= boxSize * std::floor(dx * inverseBoxSize + static_cast<dtype>(.5));
+                    }
+                    distances[j] += dx * dx;
+                }
+            }
+
+            const auto id1 = cell.ids[i];
+            for (std::size_t j = 0; j < nNeighbors; ++j) {
+                if (neighborhood.ids[j] > id1 && distances[j] <= cutoffSquared) {
+                    func(id1, neighborhood.ids[j], distances[j]);
+                }
+            }
+        }
+    }
+
+    template<typename ParticleCollection, typename F>
+    void forEachScalarPairInRange(const ParticleCollection &collection, typename Index::value_type cellIndex,
+                                  dtype cutoffSquared, F &&func) const {
+        forEachNeighborInCell<false>([this, &collection, cutoffSquared, &func](const auto &id1, const auto &id2) {
+            const auto &p1 = collection.positionOf(id1);
+            const auto &p2 = collection.positionOf(id2);
+            dtype distSquared {0};
+            for (std::size_t d = 0; d < DIM; ++d) {
+                auto dx = p2[d] - p1[d];
+                if constexpr(periodic) {
+                    dx -= _gridSize[d] * std::floor(dx / _gridSize[d] + static_cast<dtype>(.5));
+                }
+                distSquared += dx * dx;
+            }
+            if (distSquared <= cutoffSquared) {
+                func(id1, id2, distSquared);
+            }
+        }, cellIndex);
+    }
+
+    [[nodiscard]] std::size_t tableEntries(int nSubdivides) const {
+        std::size_t nCells {1};
+        std::size_t nAdjacentCells {1};
+        for (int i = 0; i < DIM; ++i) {
+            const auto cells = static_cast<std::size_t>(_gridSize[i] / (_interactionRadius / nSubdivides));
+            nCells *= cells;
+            nAdjacentCells *= std::min(cells, static_cast<std::size_t>(2 * nSubdivides + 1));
+        }
+        return nCells * (2 + nAdjacentCells);
+    }
+
+    [[nodiscard]] bool useTable(std::size_t entries) const {
+        return _adjacencyMode == Adjacency::table || (_adjacencyMode == Adjacency::automatic &&
+                                                       entries <= maxTableEntries);
+    }
+
+    void buildDense() {
+        // initialize head to reflect the total number of cells
+        head.resize(_index.size());
+        // compute adjacencies among cells and store in arrays, unless they are computed from the stencil
+        _useTable = useTable(tableEntries(_nSubdivides));
+        if (_useTable) {
+            _adjacency = CellAdjacency<Index, periodic>{_index, _nSubdivides};
+        }
+        _denseBuilt = true;
+    }
+
+    /**
+     * Flat index offsets of the cells within nSubdivides cells along each axis, valid in the interior of the grid.
+     */
+    void buildStencil() {
+        _stencil.assign(1, 0);
+        for (std::size_t d = 0; d < DIM; ++d) {
+            std::vector<typename Index::value_type> extended;
+            for (const auto offset : _stencil) {
+                for (auto i = -_nSubdivides; i <= _nSubdivides; ++i) {
+                    extended.push_back(offset + i * _strides[d]);
+                }
+            }
+            _stencil = std::move(extended);
+        }
+        std::sort(_stencil.begin(), _stencil.end());
+    }
+
+    void clearSparse() {
+        cellSlots.clear();
+        occupiedCells.clear();
+        sparseHead.clear();
+    }
+
+    /**
+     * Computes the cells of the particles in parallel and links them into the occupied cells serially.
+     */
+    template<typename ParticleCollection, typename Pool>
+    void updateSparse(ParticleCollection* collection, std::shared_ptr<Pool> pool) {
+        cellOf.assign(collection->size(), -1);
+        const auto cellOp = [this](std::size_t particleId, const auto &pos, const auto &type, const auto&) {
+            if (isAllowedType(type)) {
+                cellOf[particleId] = positionToCellIndex(&pos.data[0]);
+            }
+        };
+        const auto futures = collection->forEachParticle(cellOp, pool);
+        for (const auto &future : futures) {
+            future.wait();
+        }
+
+        clearSparse();
+        for (std::size_t particleId = 0; particleId < cellOf.size(); ++particleId) {
+            if (cellOf[particleId] >= 0) {
+                const auto [it, inserted] = cellSlots.try_emplace(cellOf[particleId], occupiedCells.size());
+                if (inserted) {
+                    occupiedCells.push_back(cellOf[particleId]);
+                    sparseHead.push_back(0);
+                }
+                auto &cellHead = sparseHead[it->second];
+                list[particleId + 1] = cellHead;
+                cellHead = particleId + 1;
+            }
+        }
+    }
+
+    /**
+     * Head of a traversed cell, i.e., a flat cell index if dense or an index into the occupied cells if sparse.
+     */
+    [[nodiscard]] std::size_t headOf(typename Index::value_type cellIndex) const {
+        return _sparse ? sparseHead[cellIndex] : (*head.at(cellIndex)).load();
+    }
+
+    /**
+     * Invokes func with the head of each non-empty cell adjacent to the traversed cell cellIndex, itself included.
+     */
+    template<typename F>
+    void forEachAdjacentHead(typename Index::value_type cellIndex, F &&func) const {
+        if (_sparse) {
+            const auto cell = occupiedCells[cellIndex];
+            forEachStencilHead(_index.inverse(cell), cell, [this](auto neighborCell) {
+                return sparseHeadOf(neighborCell);
+            }, std::forward<F>(func));
+        } else if (_useTable) {
+            forEachTableHead(cellIndex, std::forward<F>(func));
+        } else {
+            forEachStencilHead(_index.inverse(cellIndex), cellIndex, [this](auto neighborCell) {
+                return (*head[neighborCell]).load();
+            }, std::forward<F>(func));
+        }
+    }
+
+    template<typename F>
+    void forEachTableHead(typename Index::value_type cellIndex, F &&func) const {
+        for (auto k = _adjacency.cellsBegin(cellIndex); k != _adjacency.cellsEnd(cellIndex); ++k) {
+            if (const auto neighborHead = (*head.at(*k)).load(); neighborHead != 0) {
+                func(neighborHead);
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t sparseHeadOf(typename Index::value_type cellIndex) const {
+        const auto it = cellSlots.find(cellIndex);
+        return it != cellSlots.end() ? sparseHead[it->second] : 0;
+    }
+
+    /**
+     * Visits the non-empty cells within nSubdivides cells along each axis of the cell ijk with flat index cellIndex,
+     * headOf(flatIndex) yields the head of a cell. In the interior of the grid, the stencil offsets are added to the
+     * flat index. Otherwise, the cells are wrapped around or clipped per axis, axes with no more than
+     * 2 * nSubdivides + 1 cells are covered entirely so that each cell is visited once, as in the CellAdjacency tables.
+     */
+    template<typename HeadOf, typename F>
+    void forEachStencilHead(const typename Index::GridDims &ijk, typename Index::value_type cellIndex,
+                            HeadOf &&headOf, F &&func) const {
+        bool interior {true};
+        for (std::size_t d = 0; d < DIM; ++d) {
+            interior &= ijk[d] >= _nSubdivides && ijk[d] + _nSubdivides < _index[d];
+        }
+        if (interior) {
+            for (const auto offset : _stencil) {
+                if (const auto neighborHead = headOf(cellIndex + offset); neighborHead != 0) {
+                    func(neighborHead);
+                }
+            }
+            return;
+        }
+
+        static thread_local std::array<std::vector<typename Index::value_type>, DIM> offsets {};
+        for (std::size_t d = 0; d < DIM; ++d) {
+            const auto n = _index[d];
+            auto &axis = offsets[d];
+            axis.clear();
+            if (periodic && 2 * _nSubdivides + 1 >= n) {
+                for (typename Index::value_type i = 0; i < n; ++i) {
+                    axis.push_back(i * _strides[d]);
+                }
+            } else {
+                for (auto i = ijk[d] - _nSubdivides; i <= ijk[d] + _nSubdivides; ++i) {
+                    if constexpr(periodic) {
+                        axis.push_back((i < 0 ? i + n : (i >= n ? i - n : i)) * _strides[d]);
+                    } else if (i >= 0 && i < n) {
+                        axis.push_back(i * _strides[d]);
+                    }
+                }
+            }
+        }
+
+        std::array<std::size_t, DIM> position {};
+        while (true) {
+            typename Index::value_type neighborIndex {0};
+            for (std::size_t d = 0; d < DIM; ++d) {
+                neighborIndex += offsets[d][position[d]];
+            }
+            if (const auto neighborHead = headOf(neighborIndex); neighborHead != 0) {
+                func(neighborHead);
+            }
+
+            std::size_t d = 0;
+            for (; d < DIM; ++d) {
+                if (++position[d] < offsets[d].size()) {
+                    break;
+                }
+                position[d] = 0;
+            }
+            if (d == DIM) {
+                break;
+            }
+        }
+    }
+
     std::array<dtype, DIM> _cellSize{};
     std::array<dtype, DIM> _gridSize{};
+    dtype _interactionRadius{};
+    int _nSubdivides{};
+    CellGrid _grid{CellGrid::automatic};
+    Adjacency _adjacencyMode{Adjacency::automatic};
+    bool _sparse{false};
+    bool _denseBuilt{false};
+    bool _useTable{false};
     std::vector<thread::copyable_atomic<std::size_t>> head{};
     std::vector<std::size_t> list{};
     Index _index{};
+    typename Index::GridDims _strides{};
     CellAdjacency<Index, periodic> _adjacency {};
+    // flat index offsets of the adjacent cells of interior cells
+    std::vector<typename Index::value_type> _stencil {};
+    // sparse grid: slot of each occupied cell, the occupied cells' flat indices and heads by slot
+    tsl::robin_map<typename Index::value_type, std::size_t> cellSlots {};
+    std::vector<typename Index::value_type> occupiedCells {};
+    std::vector<std::size_t> sparseHead {};
+    std::vector<typename Index::value_type> cellOf {};
     std::unordered_set<std::size_t> types {};
 };
 
@@ -4,17 +4,26 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <vector>
 #include <map>
 #include <future>
 #include <optional>
 #include <bitset>
+#include <random>
+#include <span>
+#include <stdexcept>
+
+#include <fmt/format.h>
 
 #include <ctiprd/vec.h>
 #include <ctiprd/config.h>
 #include "ctiprd/systems/util.h"
 #include "ctiprd/util/pbc.h"
+#include <ctiprd/util/PerfCounters.h>
+#include <ctiprd/util/Trace.h>
 #include <ctiprd/cpu/ContainerContainer.h>
 #include <ctiprd/util/distribution_utils.h>
 
@@ -64,12 +73,14 @@ namespace particles {
 struct forces {};
 struct velocities {};
 struct positions {};
+struct images {};
 
 template<typename... args>
 struct Info {
     static constexpr bool forces = false;
     static constexpr bool velocities = false;
     static constexpr bool positions = false;
+    static constexpr bool images = false;
 };
 
 template<typename... rest> struct Info<forces, rest...> : Info<rest...> {
@@ -84,6 +95,10 @@ template<typename... rest> struct Info<positions, rest...> : Info<rest...> {
     static constexpr bool positions = true;
 };
 
+template<typename... rest> struct Info<images, rest...> : Info<rest...> {
+    static constexpr bool images = true;
+};
+
 
 }
 
@@ -102,7 +117,9 @@ public:
     using MaybePosition = std::optional<Position>;
     using Force = Vec<dtype, DIM>;
     using Velocity = Vec<dtype, DIM>;
-    using ParticleType = std::size_t;
+    // number of box lengths a particle was shifted by when wrapped into the periodic box, per axis
+    using Image = std::array<std::int32_t, DIM>;
+    using ParticleType = systems::particle_type_t<System>;
 
     template<typename T>
     using ContainerType = std::vector<T>;
@@ -114,6 +131,7 @@ public:
     static constexpr bool containsPositions() { return Info::positions; }
     static constexpr bool containsForces() { return Info::forces; }
     static constexpr bool containsVelocities() { return Info::velocities; }
+    static constexpr bool containsImages() { return Info::images; }
 
     [[nodiscard]] std::size_t nParticles() const {
         return positions_.size() - blanks.size();
@@ -131,6 +149,33 @@ public:
         positions_[index] = position;
     }
 
+    void setForce(size_type index, const Force &force) {
+        forces_[index] = force;
+    }
+
+    void setVelocity(size_type index, const Velocity &velocity) {
+        velocities_[index] = velocity;
+    }
+
+    void setImage(size_type index, const Image &image) {
+        images_[index] = image;
+    }
+
+    /**
+     * Wraps a new position of the particle at index into the box, counting the crossed box lengths into its image
+     * if images are tracked. Can be called concurrently for different particles.
+     *
+     * @param index the particle
+     * @param position the position, modified in place
+     */
+    void wrapPosition(size_type index, Position &position) {
+        if constexpr(containsImages()) {
+            util::pbc::wrapPBC<System>(position, images_[index]);
+        } else {
+            util::pbc::wrapPBC<System>(position);
+        }
+    }
+
     const Position &positionOf(size_type index) const {
         return *positions_[index];
     }
@@ -138,15 +183,18 @@ public:
     template<typename T>
     void initializeParticles(std::size_t n, T &&type) requires std::convertible_to<T, std::string_view> {
         auto &generator = ctiprd::rnd::staticThreadLocalGenerator();
-        for(std::size_t i = 0; i < n; ++i) {
-            Position pos {};
+        std::array<std::uniform_real_distribution<dtype>, DIM> distributions;
+        for (std::size_t d = 0; d < DIM; ++d) {
+            distributions[d] = std::uniform_real_distribution<dtype>{-System::boxSize[d] / 2, System::boxSize[d] / 2};
+        }
+        std::vector<Position> positions (n);
+        for (auto &pos : positions) {
             for (std::size_t d = 0; d < DIM; ++d) {
-                std::uniform_real_distribution<float> dist {-System::boxSize[d] / 2, System::boxSize[d] / 2};
-                pos[d] = dist(generator);
+                pos[d] = distributions[d](generator);
             }
-
-            addParticle(pos, type);
         }
+        const std::array<std::size_t, 1> types {systems::particleTypeId<System::types>(type)};
+        addParticles(std::span<const Position>{positions}, std::span<const std::size_t>{types});
     }
 
     template<typename T>
@@ -163,7 +211,13 @@ public:
             if constexpr(containsVelocities()) {
                 velocities_.emplace_back();
             }
-            particleTypes_.push_back(type);
+            if constexpr(containsImages()) {
+                images_.emplace_back();
+            }
+            particleTypes_.push_back(static_cast<ParticleType>(type));
+            if (generations_.size() < positions_.size()) {
+                generations_.push_back(0);
+            }
         } else {
             auto ix = blanks.back();
             positions_[ix] = position;
@@ -173,13 +227,91 @@ public:
             if constexpr(containsVelocities()) {
                 velocities_[ix] = {};
             }
-            particleTypes_[ix] = type;
+            if constexpr(containsImages()) {
+                images_[ix] = {};
+            }
+            particleTypes_[ix] = static_cast<ParticleType>(type);
             blanks.pop_back();
         }
     }
 
+    /**
+     * Adds particles in bulk. Blank slots are reused in the same order as by addParticle, the remaining particles are
+     * appended after growing every buffer once. Positions are taken as they are, i.e., they are expected to lie in
+     * the box.
+     *
+     * @param positions the positions
+     * @param types one type per position, or a single type for all of them
+     * @param pool optional pool to copy with, otherwise the calling thread copies
+     */
+    template<typename Pool = config::ThreadPool>
+    void addParticles(std::span<const Position> positions, std::span<const std::size_t> types,
+                      config::PoolPtr<Pool> pool = nullptr) {
+        if (types.size() != positions.size() && types.size() != 1) {
+            throw std::invalid_argument(fmt::format("Expected one type or one type per position ({}) but got {}.",
+                                                    positions.size(), types.size()));
+        }
+        for (const auto type : types) {
+            if (type >= System::types.size()) {
+                throw std::invalid_argument(fmt::format("Particle type {} out of range for {} types.", type,
+                                                        System::types.size()));
+            }
+        }
+        const auto n = positions.size();
+        const auto nReused = std::min(n, blanks.size());
+        const auto oldSize = size();
+        const auto newSize = oldSize + n - nReused;
+        positions_.resize(newSize);
+        particleTypes_.resize(newSize);
+        generations_.resize(std::max(generations_.size(), newSize));
+        if constexpr(containsForces()) {
+            forces_.resize(newSize);
+        }
+        if constexpr(containsVelocities()) {
+            velocities_.resize(newSize);
+        }
+        if constexpr(containsImages()) {
+            images_.resize(newSize);
+        }
+
+        // the i-th added particle goes into the i-th blank from the back, then after the old end
+        const auto nBlanks = blanks.size();
+        const auto copy = [this, positions, types, nReused, nBlanks, oldSize](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                const auto ix = i < nReused ? blanks[nBlanks - 1 - i] : oldSize + i - nReused;
+                positions_[ix] = positions[i];
+                particleTypes_[ix] = static_cast<ParticleType>(types.size() == 1 ? types[0] : types[i]);
+                if constexpr(containsForces()) {
+                    forces_[ix] = {};
+                }
+                if constexpr(containsVelocities()) {
+                    velocities_[ix] = {};
+                }
+                if constexpr(containsImages()) {
+                    images_[ix] = {};
+                }
+            }
+        };
+        if (pool) {
+            const auto granularity = static_cast<std::size_t>(config::threadGranularity(pool));
+            const auto grainSize = (n + granularity - 1) / granularity;
+            std::vector<std::future<void>> futures;
+            futures.reserve(granularity);
+            for (std::size_t begin = 0; begin < n; begin += grainSize) {
+                futures.emplace_back(pool->push(copy, begin, std::min(n, begin + grainSize)));
+            }
+            for (auto &future : futures) {
+                future.get();
+            }
+        } else {
+            copy(0, n);
+        }
+        blanks.resize(nBlanks - nReused);
+    }
+
     void removeParticle(size_type index) {
         positions_[index].reset();
+        ++generations_[index];
         blanks.push_back(index);
     }
 
@@ -191,12 +323,16 @@ public:
             const auto &[pos, type] = *itAdd;
             positions_[*itRemove] = pos;
             particleTypes_[*itRemove] = type;
+            ++generations_[*itRemove];
             if constexpr(containsForces()) {
                 forces_[*itRemove] = {};
             }
             if constexpr(containsVelocities()) {
                 velocities_[*itRemove] = {};
             }
+            if constexpr(containsImages()) {
+                images_[*itRemove] = {};
+            }
             ++itAdd;
             ++itRemove;
         }
@@ -233,8 +369,13 @@ public:
                 if constexpr(containsVelocities()) {
                     velocities_[blank] = velocities_[i];
                 }
+                if constexpr(containsImages()) {
+                    images_[blank] = images_[i];
+                }
                 ++nSwapped;
             }
+            // slots beyond the new end keep their generation, so that they differ once they are appended again
+            ++generations_[i];
         }
         positions_.resize(positions_.size() - blanks.size());
         blanks.clear();
@@ -251,6 +392,9 @@ public:
                 const auto &beginPositions, const auto &endPositions,
                 auto itTypes, auto itForces, auto itVelocities
         ) {
+            const auto nSlots = static_cast<std::size_t>(std::distance(beginPositions, endPositions));
+            const util::trace::TaskScope scope {startIndex, startIndex + nSlots};
+            const util::perf::Scope counters {};
             for (auto itPos = beginPositions; itPos != endPositions; ++itPos, ++startIndex, ++itTypes) {
                 if (*itPos) {
                     if constexpr(containsForces() && containsVelocities()) {
@@ -301,6 +445,15 @@ public:
         return std::move(futures);
     }
 
+    /**
+     * The partition of slots into tasks used by forEachParticle with the same pool at the current size.
+     */
+    template<typename Pool>
+    [[nodiscard]] config::TaskPartition taskPartition(config::PoolPtr<Pool> pool) const {
+        const auto granularity = static_cast<std::size_t>(config::threadGranularity(pool));
+        return {size() / granularity, granularity};
+    }
+
     const ContainerType<MaybePosition> &positions() const {
         return positions_;
     }
@@ -309,6 +462,63 @@ public:
         return forces_;
     }
 
+    const ContainerType<Velocity> &velocities() const {
+        return velocities_;
+    }
+
+    const ContainerType<ParticleType> &types() const {
+        return particleTypes_;
+    }
+
+    const ContainerType<Image> &images() const {
+        return images_;
+    }
+
+    [[nodiscard]] const Image &imageOf(size_type index) const {
+        return images_[index];
+    }
+
+    /**
+     * Generation of a slot, which changes whenever the particle in the slot is removed or replaced. A slot holds the
+     * same particle as long as it exists and its generation does not change.
+     */
+    [[nodiscard]] std::uint32_t generationOf(size_type index) const {
+        return generations_[index];
+    }
+
+    /**
+     * Blank slots in the order in which they are reused by addParticle (last first).
+     */
+    const std::vector<size_type> &blankSlots() const {
+        return blanks;
+    }
+
+    /**
+     * Resets the collection to n slots of which the given ones are blank. Contents of the remaining slots are
+     * default-initialized and expected to be set afterwards, e.g., when restoring a checkpoint.
+     *
+     * @param n number of slots
+     * @param blankSlots blank slots in reuse order
+     */
+    void assignSlots(size_type n, std::vector<size_type> blankSlots) {
+        positions_.assign(n, Position{});
+        particleTypes_.assign(n, ParticleType{});
+        generations_.assign(n, 0);
+        if constexpr(containsForces()) {
+            forces_.assign(n, Force{});
+        }
+        if constexpr(containsVelocities()) {
+            velocities_.assign(n, Velocity{});
+        }
+        if constexpr(containsImages()) {
+            images_.assign(n, Image{});
+        }
+        for (const auto blank : blankSlots) {
+            positions_.at(blank).reset();
+        }
+        blanks = std::move(blankSlots);
+    }
+
     const Position &position(size_type index) const {
         return *positions_[index];
     }
@@ -321,7 +531,10 @@ private:
     ContainerType<MaybePosition> positions_;
     ContainerType<Force> forces_;
     ContainerType<Velocity> velocities_;
+    ContainerType<Image> images_;
     ContainerType<ParticleType> particleTypes_;
+    // never shrinks, such that slots re-appended after sort() get a new generation
+    ContainerType<std::uint32_t> generations_;
     std::vector<size_type> blanks;
 };
 
@@ -384,7 +597,7 @@ struct ParticleCollectionUpdater {
                     collection.setType(index, *type);
                 }
                 if(position) {
-                    util::pbc::wrapPBC<System>(*position);
+                    collection.wrapPosition(index, *position);
                     collection.setPosition(index, *position);
                 }
             }
@@ -393,7 +606,7 @@ struct ParticleCollectionUpdater {
                 collection.setType(index, *type);
             }
             if(position) {
-                util::pbc::wrapPBC<System>(*position);
+                collection.wrapPosition(index, *position);
                 collection.setPosition(index, *position);
             }
         }
@@ -457,7 +670,7 @@ struct SynchronizedParticleCollectionUpdater {
                     collection.setType(index, *type);
                 }
                 if(position) {
-                    util::pbc::wrapPBC<System>(*position);
+                    collection.wrapPosition(index, *position);
                     collection.setPosition(index, *position);
                 }
             }
@@ -466,7 +679,7 @@ struct SynchronizedParticleCollectionUpdater {
                 collection.setType(index, *type);
             }
             if(position) {
-                util::pbc::wrapPBC<System>(*position);
+                collection.wrapPosition(index, *position);
                 collection.setPosition(index, *position);
             }
         }
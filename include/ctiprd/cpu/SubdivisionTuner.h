@@ -0,0 +1,128 @@
+/**
+ * @file SubdivisionTuner.h
+ * @brief Run-time selection of the cell subdivision of a NeighborList from timings of its update and traversal.
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ctiprd::cpu::nl {
+
+/**
+ * Picks the number of cell subdivisions of a neighbor list which minimizes the time of its update plus traversal.
+ * While tuning, each candidate is used for a number of consecutive steps and its fastest step is kept. Afterwards
+ * the fastest candidate stays in place until the particle count moved by more than a factor retuneFactor away from
+ * the count at which it was chosen; the box is fixed, so this is the change in density.
+ *
+ * Usage: begin() right before the neighbor list update and end() right after the traversal. Both are no-ops unless
+ * the tuner is enabled.
+ */
+class SubdivisionTuner {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::vector<int> candidates {1, 2, 3, 4};
+        std::size_t samples {3};
+        double retuneFactor {2.};
+        // candidates whose adjacency tables would hold more entries are skipped
+        std::size_t maxAdjacencyEntries {std::size_t{1} << 25};
+    };
+
+    SubdivisionTuner() = default;
+
+    explicit SubdivisionTuner(Options options) : options(std::move(options)) {}
+
+    void enable(bool on = true) {
+        enabled_ = on;
+        tuning_ = false;
+        reference = 0;
+    }
+
+    [[nodiscard]] bool enabled() const {
+        return enabled_;
+    }
+
+    [[nodiscard]] bool tuning() const {
+        return tuning_;
+    }
+
+    /**
+     * Starts tuning if the particle count changed enough and, while tuning, switches to the next candidate.
+     */
+    template<typename NeighborList>
+    void begin(NeighborList &neighborList, std::size_t nParticles) {
+        if (!enabled_) {
+            return;
+        }
+        if (!tuning_ && retune(nParticles)) {
+            start(neighborList, nParticles);
+        }
+        if (tuning_ && neighborList.nSubdivides() != candidates[current]) {
+            neighborList.setSubdivides(candidates[current]);
+        }
+        startTime = Clock::now();
+    }
+
+    /**
+     * Records the time since begin() and, once all candidates are sampled, rebuilds with the fastest of them.
+     */
+    template<typename NeighborList>
+    void end(NeighborList &neighborList) {
+        if (!enabled_ || !tuning_) {
+            return;
+        }
+        times[current] = std::min(times[current], Clock::now() - startTime);
+        if (++nSamples == options.samples) {
+            nSamples = 0;
+            if (++current == candidates.size()) {
+                const auto fastest = std::min_element(times.begin(), times.end()) - times.begin();
+                neighborList.setSubdivides(candidates[fastest]);
+                tuning_ = false;
+            }
+        }
+    }
+
+private:
+    [[nodiscard]] bool retune(std::size_t nParticles) const {
+        if (reference == 0) {
+            return true;
+        }
+        const auto ratio = static_cast<double>(std::max<std::size_t>(nParticles, 1)) / static_cast<double>(reference);
+        return ratio > options.retuneFactor || ratio * options.retuneFactor < 1.;
+    }
+
+    template<typename NeighborList>
+    void start(const NeighborList &neighborList, std::size_t nParticles) {
+        candidates.clear();
+        for (const auto candidate : options.candidates) {
+            if (neighborList.adjacencyEntries(candidate) <= options.maxAdjacencyEntries) {
+                candidates.push_back(candidate);
+            }
+        }
+        reference = std::max<std::size_t>(nParticles, 1);
+        if (candidates.empty()) {
+            return;
+        }
+        times.assign(candidates.size(), Clock::duration::max());
+        current = 0;
+        nSamples = 0;
+        tuning_ = true;
+    }
+
+    Options options {};
+    bool enabled_ {false};
+    bool tuning_ {false};
+    std::size_t reference {0};
+    std::vector<int> candidates {};
+    std::vector<Clock::duration> times {};
+    std::size_t current {0};
+    std::size_t nSamples {0};
+    Clock::time_point startTime {};
+};
+
+}
@@ -6,22 +6,34 @@
  */
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <variant>
 #include <algorithm>
 
 #include <ctiprd/any.h>
 #include <ctiprd/reactions/doi.h>
-#include <ctiprd/cpu/NeighborList.h>
+#include <ctiprd/cpu/MultiResolutionNeighborList.h>
 #include <ctiprd/cpu/ParticleCollection.h>
 #include <ctiprd/cpu/reactions.h>
+#include <ctiprd/cpu/SubdivisionTuner.h>
+#include <ctiprd/util/Profiler.h>
 
 namespace ctiprd::cpu {
 
+/**
+ * A reaction event, laid out so that the small members pack behind the particle ids.
+ *
+ * @tparam ParticleType the (compact) particle type id type
+ * @tparam ReactionIndex type of the index into the per-type(-pair) reaction lists
+ */
+template<typename ParticleType, typename ReactionIndex>
 struct ReactionEvent {
-    std::uint8_t nEducts {};
     std::size_t id1 {}, id2 {};
-    std::size_t reactionIndex {};
-    std::size_t type1 {}, type2 {};
+    ParticleType type1 {}, type2 {};
+    ReactionIndex reactionIndex {};
+    std::uint8_t nEducts {};
     bool valid {true};
 };
 
@@ -29,7 +41,7 @@ template<typename ParticleCollection, typename System, typename Generator=config
 struct UncontrolledApproximation {
     static constexpr std::size_t DIM = System::DIM;
     using dtype = typename System::dtype;
-    using NeighborList = nl::NeighborList<DIM, System::periodic, dtype, false>;
+    using NeighborLists = nl::MultiResolutionNeighborList<DIM, System::periodic, dtype, false>;
 
     using ReactionsO1 = typename System::ReactionsO1;
     using ReactionsO2 = typename System::ReactionsO2;
@@ -39,50 +51,87 @@ struct UncontrolledApproximation {
     static constexpr int nReactionsO1 = std::tuple_size_v<ReactionsO1>;
     static constexpr int nReactionsO2 = std::tuple_size_v<ReactionsO2>;
 
-    explicit UncontrolledApproximation(const System &system) {
-        if constexpr(nReactionsO2 > 0) {
-            auto cutoff = ctiprd::reactions::reactionRadius<dtype>(system.reactionsO2);
-            neighborList_ = std::make_unique<NeighborList>(System::boxSize, cutoff);
-        }
+    using ParticleType = typename ParticleCollection::ParticleType;
+    using ReactionIndex = systems::smallest_uint_t<std::max(nReactionsO1, nReactionsO2)>;
+    using Event = ReactionEvent<ParticleType, ReactionIndex>;
 
+    /**
+     * @param system the system
+     * @param mergeFactor ratio of reaction radii up to which type pairs share a neighbor list
+     */
+    explicit UncontrolledApproximation(const System &system,
+                                       dtype mergeFactor = NeighborLists::defaultMergeFactor) {
         std::tie(reactionsO1, backingO1) = reactions::impl::generateMapO1<Updater>(system);
         std::tie(reactionsO2, backingO2) = reactions::impl::generateMapO2<Updater>(system);
 
-        if(neighborList_) {
-            std::unordered_set<std::size_t> neighborListTypes{};
-            for (const auto &reactionElement: reactionsO2) {
-                if (!reactionElement.second.empty()) {
-                    neighborListTypes.emplace(std::get<0>(reactionElement.first));
-                    neighborListTypes.emplace(std::get<1>(reactionElement.first));
+        if constexpr(nReactionsO2 > 0) {
+            std::vector<typename NeighborLists::PairRadius> radii;
+            for (const auto &[types, reactions] : reactionsO2) {
+                for (const auto *reaction : reactions) {
+                    radii.push_back({std::get<0>(types), std::get<1>(types), std::sqrt(reaction->radiusSquared)});
                 }
             }
-            neighborList_->setTypes(neighborListTypes);
+            neighborLists_ = NeighborLists(System::boxSize, std::move(radii), mergeFactor);
         }
     }
 
     template<typename Pool>
-    void reactions(const dtype tau, std::shared_ptr<ParticleCollection> particles, std::shared_ptr<Pool> pool) {
+    void reactions(const dtype tau, std::shared_ptr<ParticleCollection> particles, std::shared_ptr<Pool> pool,
+                   util::Profiler *profiler = nullptr) {
+        updateProbabilities(tau);
 
-        std::vector<std::future<void>> futures;
+        if constexpr(nReactionsO2 > 0) {
+            subdivisionTuner.begin(neighborLists_, particles->nParticles());
+            const util::Profiler::Scope scope {profiler, util::Phase::reactionNeighborList};
+            neighborLists_.update(particles.get(), pool);
+        }
 
+        auto events = screen(particles, pool, profiler);
         if constexpr(nReactionsO2 > 0) {
-            neighborList_->update(particles.get(), pool);
+            subdivisionTuner.end(neighborLists_);
+        }
+        resolve(events, *particles, profiler);
+    }
+
+    /**
+     * Updates the reaction probabilities if the time step changed.
+     */
+    void updateProbabilities(const dtype tau) {
+        if (prevTau != tau) {
+            prevTau = tau;
+
+            for (auto &reaction : backingO1) {
+                reaction->updateProbability(tau);
+            }
+            for (auto &reaction : backingO2) {
+                reaction->updateProbability(tau);
+            }
         }
+    }
 
+    /**
+     * Draws the events of one step, second order events require up-to-date neighbor lists. Each neighbor list is
+     * screened at its own radius for the type pairs it is responsible for.
+     */
+    template<typename Pool>
+    [[nodiscard]] std::vector<Event> screen(std::shared_ptr<ParticleCollection> particles, std::shared_ptr<Pool> pool,
+                                            util::Profiler *profiler = nullptr) {
+        std::vector<std::future<void>> futures;
         std::mutex mutex;
-        std::vector<ReactionEvent> events;
+        std::vector<Event> events;
         {
+            const util::Profiler::Scope scope {profiler, util::Phase::screening};
             {
-                const auto worker = [this, tau, neighborList = neighborList_.get(), data = particles.get(), &events, &mutex](
+                const auto worker = [this, data = particles.get(), &events, &mutex](
                         const auto particleId, typename ParticleCollection::Position &pos,
                         const typename ParticleCollection::ParticleType &type,
                         const auto &/*ignore*/
                 ) {
-                    std::vector<ReactionEvent> localEvents;
+                    std::vector<Event> localEvents;
                     const auto &reactions = reactionsO1[type];
                     for (std::size_t i = 0; i < reactions.size(); ++i) {
-                        if (reactions[i]->shouldPerform(tau)) {
-                            localEvents.push_back({1, particleId, particleId, i, type, 0});
+                        if (reactions[i]->shouldPerform()) {
+                            localEvents.push_back({particleId, particleId, type, 0, static_cast<ReactionIndex>(i), 1});
                         }
                     }
 
@@ -98,63 +147,118 @@ struct UncontrolledApproximation {
             }
 
             if constexpr(nReactionsO2 > 0) {
-                const auto that = this;
-                const auto worker = [that, tau, &data = *particles, &mutex, &events](const auto &cellIndex) {
-                    std::vector<ReactionEvent> localEvents;
-
-                    that->neighborList_->template forEachNeighborInCell<false>([that, tau, &localEvents, &data](const auto &id1, const auto &id2) {
-                        const auto type1 = data.typeOf(id1);
-                        const auto type2 = data.typeOf(id2);
-                        const auto &position1 = data.positionOf(id1);
-                        const auto &position2 = data.positionOf(id2);
-
-                        const auto &reactions = that->reactionsO2[{type1, type2}];
-
-                        const auto distsq = util::pbc::shortestDifference<System>(position1, position2).normSquared();
-                        for (std::size_t i = 0; i < reactions.size(); ++i) {
-                            if (distsq <= reactions[i]->radiusSquared && reactions[i]->shouldPerform(tau)) {
-                                localEvents.push_back({2, id1, id2, i, type1, type2});
+                for (std::size_t c = 0; c < neighborLists_.size(); ++c) {
+                    const auto that = this;
+                    const auto &neighborList = neighborLists_.grid(c);
+                    const auto radiusSquared = neighborLists_.radius(c) * neighborLists_.radius(c);
+                    const auto worker = [that, c, &neighborList, radiusSquared, &data = *particles, &mutex, &events,
+                                         profiler](const auto &cellIndex) {
+                        std::vector<Event> localEvents;
+                        [[maybe_unused]] std::uint64_t nPairs {0};
+
+                        const auto callback = [that, c, &localEvents, &data, &nPairs](const auto &id1, const auto &id2,
+                                                                                      const auto &distsq) {
+                            if constexpr(util::profiling) {
+                                ++nPairs;
                             }
+                            const auto type1 = data.typeOf(id1);
+                            const auto type2 = data.typeOf(id2);
+                            if (that->neighborLists_.classOf(type1, type2) != c) {
+                                // not reacting or screened by another neighbor list
+                                return;
+                            }
+
+                            const auto &reactions = that->reactionsO2[{type1, type2}];
+                            for (std::size_t i = 0; i < reactions.size(); ++i) {
+                                if (distsq <= reactions[i]->radiusSquared && reactions[i]->shouldPerform()) {
+                                    localEvents.push_back({id1, id2, type1, type2, static_cast<ReactionIndex>(i), 2});
+                                }
+                            }
+                        };
+                        neighborList.forEachPairInRange(data, cellIndex, radiusSquared, callback);
+                        if (profiler && nPairs > 0) {
+                            profiler->count(util::Counter::pairsScreened, nPairs);
                         }
-                    }, cellIndex);
 
-                    {
-                        std::scoped_lock lock{mutex};
-                        events.reserve(events.size() + localEvents.size());
-                        events.insert(end(events), begin(localEvents), end(localEvents));
-                    }
-                };
-                auto cellFutures = neighborList_->forEachCell(worker, pool);
-                std::move(begin(cellFutures), end(cellFutures), std::back_inserter(futures));
+                        {
+                            std::scoped_lock lock{mutex};
+                            events.reserve(events.size() + localEvents.size());
+                            events.insert(end(events), begin(localEvents), end(localEvents));
+                        }
+                    };
+                    auto cellFutures = neighborList.forEachCell(worker, pool);
+                    std::move(begin(cellFutures), end(cellFutures), std::back_inserter(futures));
+                }
             }
+            for (auto &future : futures) { future.wait(); }
+        }
+        if (profiler) {
+            profiler->count(util::Counter::eventsGenerated, events.size());
         }
-        for (auto &future : futures) { future.wait(); }
+
+        return events;
+    }
+
+    /**
+     * Performs the events in random order, events whose educts already reacted are dropped.
+     */
+    void resolve(std::vector<Event> &events, ParticleCollection &particles, util::Profiler *profiler = nullptr) {
+        nEventsO1.fill(0);
+        nEventsO2.fill(0);
 
         {
+            const util::Profiler::Scope scope {profiler, util::Phase::shuffle};
             std::shuffle(begin(events), end(events), rnd::staticThreadLocalGenerator<Generator>());
-            Updater updater {*particles};
-
-            for(auto it = begin(events); it != end(events); ++it) {
-                if(it->valid) {
-                    if (it->nEducts == 1) {
-                        (*reactionsO1[it->type1][it->reactionIndex])(it->id1, *particles, updater);
-                    } else {
-                        (*reactionsO2[{it->type1, it->type2}][it->reactionIndex])(it->id1, it->id2, *particles, updater);
-                    }
-                    for (auto it2 = it + 1; it2 != end(events); ++it2) {
-                        if(it2->valid && (it->id1 == it2->id1 || it->id1 == it2->id2 || it->id2 == it2->id1 || it->id2 == it2->id2)) {
-                            it2->valid = false;
+        }
+        const util::Profiler::Scope scope {profiler, util::Phase::resolve};
+        [[maybe_unused]] std::uint64_t nConflicts {0};
+        Updater updater {particles};
+
+        for(auto it = begin(events); it != end(events); ++it) {
+            if(it->valid) {
+                if (it->nEducts == 1) {
+                    const auto &reaction = *reactionsO1[it->type1][it->reactionIndex];
+                    reaction(it->id1, particles, updater);
+                    ++nEventsO1[reaction.index];
+                } else {
+                    const auto &reaction = *reactionsO2[{it->type1, it->type2}][it->reactionIndex];
+                    reaction(it->id1, it->id2, particles, updater);
+                    ++nEventsO2[reaction.index];
+                }
+                for (auto it2 = it + 1; it2 != end(events); ++it2) {
+                    if(it2->valid && (it->id1 == it2->id1 || it->id1 == it2->id2 || it->id2 == it2->id1 || it->id2 == it2->id2)) {
+                        it2->valid = false;
+                        if constexpr(util::profiling) {
+                            ++nConflicts;
                         }
                     }
                 }
             }
         }
-        if constexpr(nReactionsO2 > 0) {
-            // particles->sort();
+        if (profiler) {
+            profiler->count(util::Counter::conflictsDropped, nConflicts);
         }
     }
 
-    std::unique_ptr<NeighborList> neighborList_;
+    /**
+     * Number of events performed during the last call to reactions(), per reaction in System::ReactionsO1.
+     */
+    [[nodiscard]] const std::array<std::uint64_t, nReactionsO1> &eventsO1() const {
+        return nEventsO1;
+    }
+
+    /**
+     * Number of events performed during the last call to reactions(), per reaction in System::ReactionsO2.
+     */
+    [[nodiscard]] const std::array<std::uint64_t, nReactionsO2> &eventsO2() const {
+        return nEventsO2;
+    }
+
+    NeighborLists neighborLists_;
+    nl::SubdivisionTuner subdivisionTuner;
+    std::array<std::uint64_t, nReactionsO1> nEventsO1 {};
+    std::array<std::uint64_t, nReactionsO2> nEventsO2 {};
+    dtype prevTau {0};
     reactions::impl::ReactionsO1Map<Updater> reactionsO1;
     reactions::impl::ReactionsO1Backing<Updater> backingO1;
     reactions::impl::ReactionsO2Map<Updater> reactionsO2;
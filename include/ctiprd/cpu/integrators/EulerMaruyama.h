@@ -1,6 +1,10 @@
 #pragma oncecpu
 
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <span>
+#include <vector>
 
 #include <ctiprd/potentials/util.h>
 #include <ctiprd/util/distribution_utils.h>
@@ -9,19 +13,12 @@
 #include <ctiprd/cpu/NeighborList.h>
 #include <ctiprd/cpu/ForceField.h>
 #include <ctiprd/cpu/UncontrolledApproximation.h>
+#include <ctiprd/cpu/observables/Observable.h>
 #include <ctiprd/util/pbc.h>
+#include <ctiprd/util/Profiler.h>
 
 namespace ctiprd::cpu::integrator {
 
-namespace detail {
-template<typename dtype>
-auto &normalDistribution() {
-    static thread_local std::normal_distribution<dtype> distribution{};
-    return distribution;
-}
-
-}
-
 template<systems::system System, typename Pool = config::ThreadPool, typename Generator = std::mt19937,
          typename ParticleCollection = ParticleCollection<System, particles::positions, particles::forces>,
          typename ForceField = potentials::ForceField<ParticleCollection, System>,
@@ -30,9 +27,22 @@ class EulerMaruyama {
 public:
     using Info = systems::SystemInfo<System>;
     using Particles = ParticleCollection;
+    using RandomGenerator = Generator;
+    using dtype = typename Info::dtype;
+    using Observables = observables::Observables<Particles, Pool>;
 
     static constexpr const char *name = "EulerMaruyama";
 
+    /**
+     * Integrator state besides particles and random number generators, required to continue a run exactly.
+     */
+    struct State {
+        std::uint64_t nSteps {0};
+        dtype prevIntegrationStep {0};
+        std::array<dtype, Info::nTypes> randomDisplacementPrefactors {};
+        std::array<dtype, Info::nTypes> deterministicDisplacementPrefactors {};
+    };
+
     explicit EulerMaruyama(const System &system, config::PoolPtr<Pool> pool) :
             particles_(std::make_shared<Particles>()), pool_(pool), system(system),
             forceField(std::make_unique<ForceField>(system)),
@@ -43,6 +53,45 @@ public:
         return particles_;
     }
 
+    Observables &observables() {
+        return observables_;
+    }
+
+    /**
+     * Time spent per phase and work counts accumulated over all steps, all zero unless built with CTIPRD_PROFILING.
+     */
+    [[nodiscard]] util::Profile profile() const {
+        return profiler_.profile();
+    }
+
+    void resetProfile() {
+        profiler_.reset();
+    }
+
+    /**
+     * Lets the force and reaction neighbor lists pick their cell subdivision from timings of the first steps, and
+     * again whenever the number of particles changed by more than a factor of two.
+     */
+    void autoTuneNeighborLists(bool enabled = true) {
+        forceField->subdivisionTuner.enable(enabled);
+        reactions->subdivisionTuner.enable(enabled);
+    }
+
+    [[nodiscard]] std::uint64_t nSteps() const {
+        return nSteps_;
+    }
+
+    [[nodiscard]] State state() const {
+        return {nSteps_, prevIntegrationStep, randomDisplacementPrefactors, deterministicDisplacementPrefactors};
+    }
+
+    void restore(const State &state) {
+        nSteps_ = state.nSteps;
+        prevIntegrationStep = state.prevIntegrationStep;
+        randomDisplacementPrefactors = state.randomDisplacementPrefactors;
+        deterministicDisplacementPrefactors = state.deterministicDisplacementPrefactors;
+    }
+
     void step(double stepSize) {
 
         if(prevIntegrationStep != stepSize) {
@@ -54,42 +103,83 @@ public:
             }
         }
 
+        auto *profiler = util::Profiler::enabled ? &profiler_ : nullptr;
+
+        typename Observables::Context context {nSteps_, *particles_, pool_, particles_->taskPartition(pool_)};
+        {
+            const util::Profiler::Scope scope {profiler, util::Phase::observables};
+            observables_.begin(context);
+        }
+
+        std::span<config::TaskSlot<dtype>> energySlots {};
+        if (observables_.needsEnergy()) {
+            energies.assign(context.partition.nTasks, {});
+            energySlots = energies;
+        }
+
         if constexpr(Info::hasForces()) {
-            forceField->forces(particles_, pool_);
+            forceField->forces(particles_, pool_, true, energySlots, profiler);
         }
 
-        const auto worker = [this]
-                (const auto &, typename Particles::Position &pos, const typename Particles::ParticleType &type,
-                 const typename Particles::Force &force) {
+        const auto displace = [this](std::size_t id, typename Particles::Position &pos,
+                                     const typename Particles::ParticleType &type,
+                                     const typename Particles::Force &force) {
             pos += force * deterministicDisplacementPrefactors[type] + noise() * randomDisplacementPrefactors[type];
-            util::pbc::wrapPBC<System>(pos);
+            particles_->wrapPosition(id, pos);
         };
 
-        auto futures = particles_->forEachParticle(worker, pool_);
-        for(auto &future : futures) {
-            future.wait();
+        {
+            const util::Profiler::Scope scope {profiler, util::Phase::diffusion};
+            if (observables_.observesParticles()) {
+                // observables see the configuration at the beginning of the step
+                sweep([&displace, &observables = observables_, partition = context.partition]
+                      (const auto &id, typename Particles::Position &pos, const typename Particles::ParticleType &type,
+                       const typename Particles::Force &force) {
+                    observables.particle(partition(id), id, pos, type);
+                    displace(id, pos, type, force);
+                });
+            } else {
+                sweep([&displace](const auto &id, typename Particles::Position &pos,
+                                  const typename Particles::ParticleType &type,
+                                  const typename Particles::Force &force) {
+                    displace(id, pos, type, force);
+                });
+            }
         }
 
         if constexpr(Info::hasReactions()) {
-            reactions->reactions(stepSize, particles_, pool_);
-
-            if constexpr(Info::periodic) {
-                const auto fut = particles_->forEachParticle([](const auto &, auto &pos, const auto &, const auto &) {
-                    util::pbc::wrapPBC<System>(pos);
-                }, pool_);
-                for(auto &future : fut) {
-                    future.wait();
-                }
+            // the updaters only ever write wrapped positions, no additional pbc sweep necessary
+            reactions->reactions(stepSize, particles_, pool_, profiler);
+        }
+
+        if (observables_.active()) {
+            for (const auto &slot : energySlots) {
+                context.potentialEnergy += slot.value;
             }
+            if constexpr(Info::hasReactions()) {
+                context.eventsO1 = reactions->eventsO1();
+                context.eventsO2 = reactions->eventsO2();
+            }
+            const util::Profiler::Scope scope {profiler, util::Phase::observables};
+            observables_.end(context);
         }
+        ++nSteps_;
     }
 
 private:
 
+    template<typename F>
+    void sweep(F &&worker) {
+        auto futures = particles_->forEachParticle(std::forward<F>(worker), pool_);
+        for(auto &future : futures) {
+            future.wait();
+        }
+    }
+
     static typename Particles::Position noise() {
         typename Particles::Position out;
         std::generate(begin(out.data), end(out.data), []() {
-            return detail::normalDistribution<typename Info::dtype>()(rnd::staticThreadLocalGenerator<Generator>());
+            return rnd::normal<typename Info::dtype, Generator>();
         });
         return out;
     }
@@ -100,6 +190,10 @@ private:
     std::array<typename Info::dtype, Info::nTypes> randomDisplacementPrefactors {};
     std::array<typename Info::dtype, Info::nTypes> deterministicDisplacementPrefactors {};
     typename Info::dtype prevIntegrationStep {0};
+    std::uint64_t nSteps_ {0};
+    Observables observables_;
+    std::vector<config::TaskSlot<dtype>> energies;
+    util::Profiler profiler_;
     config::PoolPtr<Pool> pool_;
     System system;
 };
@@ -0,0 +1,246 @@
+/**
+ * @file Observable.h
+ * @brief Observables evaluated by the integrator during its own sweeps, recorded into preallocated time series.
+ *
+ * An observable that is due in a step sees the configuration at the beginning of that step: it is visited with every
+ * particle during the integrator's position update sweep (before the particle is moved) and accumulates into per-task
+ * slots, which are reduced and recorded once the step, including its reactions, has finished.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <ctiprd/config.h>
+#include <ctiprd/cpu/ParticleCollection.h>
+
+namespace ctiprd::cpu::observables {
+
+/**
+ * Fixed-capacity series of equally shaped frames in one contiguous allocation. Storage never moves, so views onto it
+ * stay valid for the lifetime of the series.
+ *
+ * @tparam T the element type
+ */
+template<typename T>
+class TimeSeries {
+public:
+    TimeSeries(std::size_t capacity, std::vector<std::size_t> frameShape)
+            : frameShape_(std::move(frameShape)),
+              frameSize_(std::accumulate(begin(frameShape_), end(frameShape_), std::size_t {1},
+                                         std::multiplies<>())),
+              data_(capacity * frameSize_), steps_(capacity) {}
+
+    /**
+     * Appends a zero-initialized frame.
+     *
+     * @param step the step the frame belongs to
+     * @return the frame to be filled
+     */
+    std::span<T> append(std::uint64_t step) {
+        if (size_ == capacity()) {
+            throw std::length_error(fmt::format("Time series is full after {} frames, increase its capacity.",
+                                                capacity()));
+        }
+        steps_[size_] = step;
+        return {data_.data() + frameSize_ * size_++, frameSize_};
+    }
+
+    [[nodiscard]] std::span<const T> frame(std::size_t k) const {
+        return {data_.data() + frameSize_ * k, frameSize_};
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] std::size_t capacity() const {
+        return steps_.size();
+    }
+
+    [[nodiscard]] const std::vector<std::size_t> &frameShape() const {
+        return frameShape_;
+    }
+
+    [[nodiscard]] std::size_t frameSize() const {
+        return frameSize_;
+    }
+
+    [[nodiscard]] const T *data() const {
+        return data_.data();
+    }
+
+    [[nodiscard]] const std::uint64_t *steps() const {
+        return steps_.data();
+    }
+
+private:
+    std::vector<std::size_t> frameShape_;
+    std::size_t frameSize_;
+    std::vector<T> data_;
+    std::vector<std::uint64_t> steps_;
+    std::size_t size_ {0};
+};
+
+/**
+ * What the integrator knows about the current step. Potential energy and reaction events are only available once
+ * the step has finished, i.e., in Observable::end.
+ */
+template<typename Particles, typename Pool>
+struct StepContext {
+    using dtype = typename Particles::dtype;
+
+    std::uint64_t step;
+    // not to be modified by observables, mutable only to allow for parallel sweeps (e.g., neighbor list updates)
+    Particles &particles;
+    config::PoolPtr<Pool> pool;
+    config::TaskPartition partition;
+
+    // potential energy of the configuration at the beginning of the step, if requested
+    dtype potentialEnergy {0};
+    // events performed during the step per reaction in System::ReactionsO1 and System::ReactionsO2
+    std::span<const std::uint64_t> eventsO1 {};
+    std::span<const std::uint64_t> eventsO2 {};
+};
+
+template<typename Particles, typename Pool = config::ThreadPool>
+class Observable {
+public:
+    using dtype = typename Particles::dtype;
+    using Position = typename Particles::Position;
+    using ParticleType = typename Particles::ParticleType;
+    using Context = StepContext<Particles, Pool>;
+
+    explicit Observable(std::size_t stride) : stride_(std::max<std::size_t>(stride, 1)) {}
+
+    virtual ~Observable() = default;
+
+    [[nodiscard]] std::size_t stride() const {
+        return stride_;
+    }
+
+    [[nodiscard]] virtual bool due(std::uint64_t step) const {
+        return step % stride_ == 0;
+    }
+
+    /**
+     * Whether particle() needs to be called for every particle when due.
+     */
+    [[nodiscard]] virtual bool observesParticles() const {
+        return true;
+    }
+
+    /**
+     * Whether the potential energy needs to be evaluated when due.
+     */
+    [[nodiscard]] virtual bool needsEnergy() const {
+        return false;
+    }
+
+    /**
+     * Called before the step when due, typically to reset the per-task slots to context.partition.nTasks.
+     */
+    virtual void begin(const Context &context) {}
+
+    /**
+     * Called concurrently for each particle, calls with the same task are never concurrent.
+     */
+    virtual void particle(std::size_t task, std::size_t id, const Position &pos, const ParticleType &type) {}
+
+    /**
+     * Called after the step when due, reduces the per-task slots and records a frame.
+     */
+    virtual void end(const Context &context) = 0;
+
+private:
+    std::size_t stride_;
+};
+
+/**
+ * The observables attached to an integrator.
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class Observables {
+public:
+    using ObservableType = Observable<Particles, Pool>;
+    using Context = typename ObservableType::Context;
+
+    template<typename T, typename... Args>
+    std::shared_ptr<T> add(Args &&... args) {
+        auto observable = std::make_shared<T>(std::forward<Args>(args)...);
+        add(observable);
+        return observable;
+    }
+
+    void add(std::shared_ptr<ObservableType> observable) {
+        observables.push_back(std::move(observable));
+    }
+
+    void remove(const std::shared_ptr<ObservableType> &observable) {
+        observables.erase(std::remove(observables.begin(), observables.end(), observable), observables.end());
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return observables.size();
+    }
+
+    /**
+     * Selects the observables which are due in this step and prepares them.
+     */
+    void begin(const Context &context) {
+        due.clear();
+        sweep.clear();
+        energy = false;
+        for (const auto &observable : observables) {
+            if (observable->due(context.step)) {
+                observable->begin(context);
+                due.push_back(observable.get());
+                if (observable->observesParticles()) {
+                    sweep.push_back(observable.get());
+                }
+                energy |= observable->needsEnergy();
+            }
+        }
+    }
+
+    [[nodiscard]] bool active() const {
+        return !due.empty();
+    }
+
+    [[nodiscard]] bool observesParticles() const {
+        return !sweep.empty();
+    }
+
+    [[nodiscard]] bool needsEnergy() const {
+        return energy;
+    }
+
+    void particle(std::size_t task, std::size_t id, const typename Particles::Position &pos,
+                  const typename Particles::ParticleType &type) const {
+        for (auto *observable : sweep) {
+            observable->particle(task, id, pos, type);
+        }
+    }
+
+    void end(const Context &context) {
+        for (auto *observable : due) {
+            observable->end(context);
+        }
+    }
+
+private:
+    std::vector<std::shared_ptr<ObservableType>> observables;
+    std::vector<ObservableType *> due;
+    std::vector<ObservableType *> sweep;
+    bool energy {false};
+};
+
+}
@@ -0,0 +1,277 @@
+/**
+ * @file basic.h
+ * @brief Particle counts, reaction event counts, potential energy, positional histograms and density grids.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include <ctiprd/util/Index.h>
+#include <ctiprd/cpu/observables/Observable.h>
+
+namespace ctiprd::cpu::observables {
+
+/**
+ * Number of particles per type, frames of shape (nTypes,).
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class ParticleCounts : public Observable<Particles, Pool> {
+public:
+    using Base = Observable<Particles, Pool>;
+    static constexpr std::size_t nTypes = Particles::SystemType::types.size();
+
+    ParticleCounts(std::size_t stride, std::size_t capacity) : Base(stride), series_(capacity, {nTypes}) {}
+
+    void begin(const typename Base::Context &context) override {
+        slots.assign(context.partition.nTasks, {});
+    }
+
+    void particle(std::size_t task, std::size_t, const typename Base::Position &,
+                  const typename Base::ParticleType &type) override {
+        ++slots[task].value[type];
+    }
+
+    void end(const typename Base::Context &context) override {
+        auto frame = series_.append(context.step);
+        for (const auto &slot : slots) {
+            std::transform(frame.begin(), frame.end(), slot.value.begin(), frame.begin(), std::plus<>());
+        }
+    }
+
+    [[nodiscard]] const TimeSeries<std::uint64_t> &series() const {
+        return series_;
+    }
+
+private:
+    std::vector<config::TaskSlot<std::array<std::uint64_t, nTypes>>> slots;
+    TimeSeries<std::uint64_t> series_;
+};
+
+/**
+ * Number of reaction events per reaction, frames of shape (nReactionsO1 + nReactionsO2,) with the first order
+ * reactions first. The frame recorded with step t holds the events performed in steps [t - stride, t), so that
+ * together with ParticleCounts it describes the events between two recorded configurations.
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class ReactionCounts : public Observable<Particles, Pool> {
+public:
+    using Base = Observable<Particles, Pool>;
+    static constexpr std::size_t nReactionsO1 = std::tuple_size_v<typename Particles::SystemType::ReactionsO1>;
+    static constexpr std::size_t nReactionsO2 = std::tuple_size_v<typename Particles::SystemType::ReactionsO2>;
+
+    ReactionCounts(std::size_t stride, std::size_t capacity)
+            : Base(stride), series_(capacity, {nReactionsO1 + nReactionsO2}) {}
+
+    [[nodiscard]] bool due(std::uint64_t) const override {
+        // accumulates every step, records every stride steps
+        return true;
+    }
+
+    [[nodiscard]] bool observesParticles() const override {
+        return false;
+    }
+
+    void end(const typename Base::Context &context) override {
+        std::transform(context.eventsO1.begin(), context.eventsO1.end(), counts.begin(), counts.begin(), std::plus<>());
+        std::transform(context.eventsO2.begin(), context.eventsO2.end(), counts.begin() + nReactionsO1,
+                       counts.begin() + nReactionsO1, std::plus<>());
+        if ((context.step + 1) % Base::stride() == 0) {
+            auto frame = series_.append(context.step + 1);
+            std::copy(counts.begin(), counts.end(), frame.begin());
+            counts.fill(0);
+        }
+    }
+
+    [[nodiscard]] const TimeSeries<std::uint64_t> &series() const {
+        return series_;
+    }
+
+private:
+    std::array<std::uint64_t, nReactionsO1 + nReactionsO2> counts {};
+    TimeSeries<std::uint64_t> series_;
+};
+
+/**
+ * Total potential energy from external and pair potentials, frames of shape (1,).
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class PotentialEnergy : public Observable<Particles, Pool> {
+public:
+    using Base = Observable<Particles, Pool>;
+
+    PotentialEnergy(std::size_t stride, std::size_t capacity) : Base(stride), series_(capacity, {1}) {}
+
+    [[nodiscard]] bool observesParticles() const override {
+        return false;
+    }
+
+    [[nodiscard]] bool needsEnergy() const override {
+        return true;
+    }
+
+    void end(const typename Base::Context &context) override {
+        series_.append(context.step)[0] = context.potentialEnergy;
+    }
+
+    [[nodiscard]] const TimeSeries<typename Base::dtype> &series() const {
+        return series_;
+    }
+
+private:
+    TimeSeries<typename Base::dtype> series_;
+};
+
+/**
+ * Histogram of particle positions along one axis per type, frames of shape (nTypes, nBins). The bins evenly divide
+ * [-boxSize/2, boxSize/2) along the axis, particles outside of it are not counted.
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class PositionHistogram : public Observable<Particles, Pool> {
+public:
+    using Base = Observable<Particles, Pool>;
+    using dtype = typename Base::dtype;
+    using System = typename Particles::SystemType;
+    static constexpr std::size_t nTypes = System::types.size();
+
+    PositionHistogram(std::size_t stride, std::size_t capacity, std::size_t axis, std::size_t nBins)
+            : Base(stride), axis(axis), nBins(nBins), series_(capacity, {nTypes, nBins}) {
+        if (axis >= System::DIM) {
+            throw std::invalid_argument(fmt::format("Axis {} out of range for a {}-dimensional system.",
+                                                    axis, System::DIM));
+        }
+        lower = -System::boxSize[axis] / 2;
+        inverseBinWidth = static_cast<dtype>(nBins) / System::boxSize[axis];
+    }
+
+    void begin(const typename Base::Context &context) override {
+        slots.resize(context.partition.nTasks);
+        for (auto &slot : slots) {
+            slot.assign(nTypes * nBins, 0);
+        }
+    }
+
+    void particle(std::size_t task, std::size_t, const typename Base::Position &pos,
+                  const typename Base::ParticleType &type) override {
+        const auto bin = std::floor((pos[axis] - lower) * inverseBinWidth);
+        if (bin >= 0 && bin < static_cast<dtype>(nBins)) {
+            ++slots[task][type * nBins + static_cast<std::size_t>(bin)];
+        }
+    }
+
+    void end(const typename Base::Context &context) override {
+        auto frame = series_.append(context.step);
+        for (const auto &slot : slots) {
+            std::transform(frame.begin(), frame.end(), slot.begin(), frame.begin(), std::plus<>());
+        }
+    }
+
+    [[nodiscard]] const TimeSeries<std::uint64_t> &series() const {
+        return series_;
+    }
+
+private:
+    std::size_t axis;
+    std::size_t nBins;
+    dtype lower;
+    dtype inverseBinWidth;
+    // one allocation per task, so that tasks do not write to shared cache lines
+    std::vector<std::vector<std::uint64_t>> slots;
+    TimeSeries<std::uint64_t> series_;
+};
+
+/**
+ * Number of particles per type on a regular grid over the box, frames of shape (nTypes, shape[0], ..., shape[DIM-1]).
+ * The cells evenly divide [-boxSize/2, boxSize/2) along each axis, particles outside of it are not counted. Only the
+ * grids are recorded, which makes this the compact alternative to trajectories for studying spatial patterns.
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class DensityGrid : public Observable<Particles, Pool> {
+public:
+    using Base = Observable<Particles, Pool>;
+    using dtype = typename Base::dtype;
+    using System = typename Particles::SystemType;
+    static constexpr std::size_t nTypes = System::types.size();
+    static constexpr std::size_t DIM = System::DIM;
+    using Index = util::Index<DIM, std::array<std::uint32_t, DIM>>;
+
+    /**
+     * @param stride evaluate every stride steps
+     * @param capacity number of frames to preallocate
+     * @param shape number of grid cells per axis
+     */
+    DensityGrid(std::size_t stride, std::size_t capacity, const std::array<std::size_t, DIM> &shape)
+            : Base(stride), index(shape), series_(capacity, frameShape(shape)) {
+        for (std::size_t d = 0; d < DIM; ++d) {
+            if (shape[d] == 0) {
+                throw std::invalid_argument(fmt::format("Grid needs at least one cell along axis {}.", d));
+            }
+            inverseCellSize[d] = static_cast<dtype>(shape[d]) / System::boxSize[d];
+        }
+    }
+
+    void begin(const typename Base::Context &context) override {
+        slots.resize(context.partition.nTasks);
+        for (auto &slot : slots) {
+            slot.assign(nTypes * index.size(), 0);
+        }
+    }
+
+    void particle(std::size_t task, std::size_t, const typename Base::Position &pos,
+                  const typename Base::ParticleType &type) override {
+        typename Index::GridDims cell {};
+        for (std::size_t d = 0; d < DIM; ++d) {
+            const auto x = std::floor((pos[d] + System::boxSize[d] / 2) * inverseCellSize[d]);
+            if (!(x >= 0 && x < static_cast<dtype>(index[d]))) {
+                return;
+            }
+            cell[d] = static_cast<std::uint32_t>(x);
+        }
+        ++slots[task][type * index.size() + index.index(cell)];
+    }
+
+    void end(const typename Base::Context &context) override {
+        auto frame = series_.append(context.step);
+        for (const auto &slot : slots) {
+            std::transform(frame.begin(), frame.end(), slot.begin(), frame.begin(), std::plus<>());
+        }
+    }
+
+    /**
+     * Centers of the grid cells along an axis.
+     */
+    [[nodiscard]] std::vector<dtype> cellCenters(std::size_t axis) const {
+        if (axis >= DIM) {
+            throw std::invalid_argument(fmt::format("Axis {} out of range for a {}-dimensional system.", axis, DIM));
+        }
+        std::vector<dtype> out (index[axis]);
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = (static_cast<dtype>(i) + static_cast<dtype>(.5)) / inverseCellSize[axis]
+                     - System::boxSize[axis] / 2;
+        }
+        return out;
+    }
+
+    [[nodiscard]] const TimeSeries<std::uint32_t> &series() const {
+        return series_;
+    }
+
+private:
+    static std::vector<std::size_t> frameShape(const std::array<std::size_t, DIM> &shape) {
+        std::vector<std::size_t> out {nTypes};
+        out.insert(out.end(), shape.begin(), shape.end());
+        return out;
+    }
+
+    Index index;
+    std::array<dtype, DIM> inverseCellSize {};
+    // one allocation per task, so that tasks do not write to shared cache lines
+    std::vector<std::vector<std::uint32_t>> slots;
+    TimeSeries<std::uint32_t> series_;
+};
+
+}
@@ -0,0 +1,195 @@
+/**
+ * @file dynamics.h
+ * @brief Mean-squared displacements from unwrapped positions, correlated online with a multi-tau scheme.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <ctiprd/cpu/observables/Observable.h>
+
+namespace ctiprd::cpu::observables {
+
+/**
+ * Mean-squared displacement per type as a function of the lag time, frames of shape (nTypes, nLags) holding the
+ * running estimate over all samples so far.
+ *
+ * Positions are sampled every stride steps and correlated with a multi-tau scheme: level 0 keeps the last
+ * blockLength samples of each particle and covers lags 1, ..., blockLength - 1 (in samples), level k keeps every
+ * 2^k-th sample and covers lags blockLength / 2 * 2^k, ..., (blockLength - 1) * 2^k. Memory per particle thus grows
+ * with the logarithm of the largest lag. Coarser levels keep samples instead of averaging them, so that every
+ * estimate is an unbiased average of squared displacements.
+ *
+ * Particles are identified by their slot, a slot restarts its history when it was empty in the previous sample, changed
+ * its type or was reused by another particle in between (detected by its generation). For periodic systems, the
+ * particle collection has to track images (particles::images).
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class MeanSquaredDisplacement : public Observable<Particles, Pool> {
+public:
+    using Base = Observable<Particles, Pool>;
+    using dtype = typename Base::dtype;
+    using System = typename Particles::SystemType;
+    static constexpr std::size_t nTypes = System::types.size();
+    static constexpr std::size_t DIM = System::DIM;
+    static_assert(!System::periodic || Particles::containsImages(),
+                  "Unwrapping periodic positions requires a particle collection tracking images.");
+
+    /**
+     * @param stride sample positions every stride steps
+     * @param capacity number of frames to preallocate
+     * @param recordStride record the running estimate every recordStride samples
+     * @param maxLag the largest lag time in steps that should be covered
+     * @param blockLength number of samples kept per particle and level, even and at least 2
+     */
+    MeanSquaredDisplacement(std::size_t stride, std::size_t capacity, std::size_t recordStride, std::size_t maxLag,
+                            std::size_t blockLength = 16)
+            : Base(stride), recordStride(std::max<std::size_t>(recordStride, 1)), blockLength(blockLength),
+              nLevels(levelsFor(maxLag, Base::stride(), blockLength)),
+              series_(capacity, {nTypes, nLags(nLevels, blockLength)}) {
+        buffers.resize(nLevels);
+        for (std::size_t level = 0; level < nLevels; ++level) {
+            const auto first = level == 0 ? std::size_t {1} : blockLength / 2;
+            for (auto j = first; j < blockLength; ++j) {
+                lags_.push_back(j << level);
+            }
+        }
+    }
+
+    void begin(const typename Base::Context &context) override {
+        particles = &context.particles;
+        slots.resize(context.partition.nTasks, Slot {std::vector<Accumulator>(nTypes * lags_.size())});
+
+        const auto nSlots = context.particles.size();
+        if (seen.size() < nSlots) {
+            seen.resize(nSlots, 0);
+            origins.resize(nSlots, 0);
+            types.resize(nSlots, 0);
+            generations.resize(nSlots, 0);
+            for (auto &buffer : buffers) {
+                buffer.resize(nSlots * blockLength * DIM);
+            }
+        }
+    }
+
+    void particle(std::size_t task, std::size_t id, const typename Base::Position &pos,
+                  const typename Base::ParticleType &type) override {
+        std::array<dtype, DIM> x {};
+        for (std::size_t d = 0; d < DIM; ++d) {
+            x[d] = pos[d];
+            if constexpr(Particles::containsImages()) {
+                x[d] += static_cast<dtype>(particles->imageOf(id)[d]) * System::boxSize[d];
+            }
+        }
+
+        const auto generation = particles->generationOf(id);
+        if (!(sample > 0 && seen[id] == sample && types[id] == type && generations[id] == generation)) {
+            origins[id] = sample;
+            types[id] = type;
+            generations[id] = generation;
+        }
+        seen[id] = sample + 1;
+
+        auto &accumulators = slots[task].accumulators;
+        std::size_t lagOffset {0};
+        for (std::size_t level = 0; level < nLevels && sample % (std::uint64_t {1} << level) == 0; ++level) {
+            const auto current = sample >> level;
+            // samples at this level since the origin, including the current one
+            const auto available = current - ((origins[id] + (std::uint64_t {1} << level) - 1) >> level) + 1;
+            auto *ring = buffers[level].data() + id * blockLength * DIM;
+            const auto first = level == 0 ? std::size_t {1} : blockLength / 2;
+            for (auto j = first; j < blockLength && j < available; ++j) {
+                const auto *previous = ring + ((current - j) % blockLength) * DIM;
+                dtype dSquared {0};
+                for (std::size_t d = 0; d < DIM; ++d) {
+                    const auto dx = x[d] - previous[d];
+                    dSquared += dx * dx;
+                }
+                auto &accumulator = accumulators[type * lags_.size() + lagOffset + j - first];
+                accumulator.sum += dSquared;
+                ++accumulator.count;
+            }
+            std::copy(x.begin(), x.end(), ring + (current % blockLength) * DIM);
+            lagOffset += blockLength - first;
+        }
+    }
+
+    void end(const typename Base::Context &context) override {
+        ++sample;
+        if (sample % recordStride == 0) {
+            auto frame = series_.append(context.step);
+            for (std::size_t ix = 0; ix < frame.size(); ++ix) {
+                double sum {0};
+                std::uint64_t count {0};
+                for (const auto &slot : slots) {
+                    sum += slot.accumulators[ix].sum;
+                    count += slot.accumulators[ix].count;
+                }
+                frame[ix] = count > 0 ? static_cast<dtype>(sum / static_cast<double>(count)) : 0;
+            }
+        }
+    }
+
+    /**
+     * Lag times in steps.
+     */
+    [[nodiscard]] std::vector<std::uint64_t> lags() const {
+        std::vector<std::uint64_t> out (lags_.size());
+        std::transform(lags_.begin(), lags_.end(), out.begin(), [this](auto lag) { return lag * Base::stride(); });
+        return out;
+    }
+
+    [[nodiscard]] const TimeSeries<dtype> &series() const {
+        return series_;
+    }
+
+private:
+    struct Accumulator {
+        double sum {0};
+        std::uint64_t count {0};
+    };
+
+    struct alignas(64) Slot {
+        std::vector<Accumulator> accumulators;
+    };
+
+    static std::size_t levelsFor(std::size_t maxLag, std::size_t stride, std::size_t blockLength) {
+        if (blockLength < 2 || blockLength % 2 != 0) {
+            throw std::invalid_argument(fmt::format("Block length must be even and at least 2 but was {}.",
+                                                    blockLength));
+        }
+        std::size_t levels {1};
+        while ((blockLength - 1) * (std::size_t {1} << (levels - 1)) * stride < maxLag) {
+            ++levels;
+        }
+        return levels;
+    }
+
+    static std::size_t nLags(std::size_t nLevels, std::size_t blockLength) {
+        return blockLength - 1 + (nLevels - 1) * blockLength / 2;
+    }
+
+    std::size_t recordStride;
+    std::size_t blockLength;
+    std::size_t nLevels;
+    std::vector<std::uint64_t> lags_;
+    const Particles *particles {nullptr};
+    std::uint64_t sample {0};
+    // per slot: sample + 1 at which it was last seen, sample its history starts at, its type and its generation
+    std::vector<std::uint64_t> seen;
+    std::vector<std::uint64_t> origins;
+    std::vector<typename Base::ParticleType> types;
+    std::vector<std::uint32_t> generations;
+    // per level: ring buffers of blockLength unwrapped positions per slot
+    std::vector<std::vector<dtype>> buffers;
+    std::vector<Slot> slots;
+    TimeSeries<dtype> series_;
+};
+
+}
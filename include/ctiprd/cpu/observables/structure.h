@@ -0,0 +1,321 @@
+/**
+ * @file structure.h
+ * @brief Radial distribution functions and static structure factors between particle types.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <ctiprd/cpu/NeighborList.h>
+#include <ctiprd/cpu/observables/Observable.h>
+
+namespace ctiprd::cpu::observables {
+
+namespace detail {
+/**
+ * Volume of a DIM-dimensional ball of radius r.
+ */
+template<std::size_t DIM, typename dtype>
+dtype ballVolume(dtype r) {
+    const auto unitBall = std::pow(std::numbers::pi_v<dtype>, static_cast<dtype>(DIM) / 2)
+                          / std::tgamma(static_cast<dtype>(DIM) / 2 + 1);
+    return unitBall * std::pow(r, static_cast<dtype>(DIM));
+}
+}
+
+/**
+ * Radial distribution functions g_ab(r) for all pairs of types, frames of shape (nTypes, nTypes, nBins). Pairs are
+ * found with a cell linked-list of radius rMax and histogrammed into per-task bins.
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class RadialDistribution : public Observable<Particles, Pool> {
+public:
+    using Base = Observable<Particles, Pool>;
+    using dtype = typename Base::dtype;
+    using System = typename Particles::SystemType;
+    static constexpr std::size_t nTypes = System::types.size();
+    using NeighborList = nl::NeighborList<System::DIM, System::periodic, dtype>;
+
+    /**
+     * @param stride evaluate every stride steps
+     * @param capacity number of frames to preallocate
+     * @param rMax the largest distance, at most half the smallest box length for periodic systems
+     * @param nBins number of bins evenly dividing [0, rMax)
+     */
+    RadialDistribution(std::size_t stride, std::size_t capacity, dtype rMax, std::size_t nBins)
+            : Base(stride), rMax(rMax), nBins(nBins), series_(capacity, {nTypes, nTypes, nBins}) {
+        if (!(rMax > 0)) {
+            throw std::invalid_argument(fmt::format("rMax must be positive, got {}.", rMax));
+        }
+        if (nBins == 0) {
+            throw std::invalid_argument("Radial distribution needs at least one bin.");
+        }
+        if constexpr(System::periodic) {
+            for (const auto length : System::boxSize) {
+                if (2 * rMax > length) {
+                    throw std::invalid_argument(fmt::format(
+                            "rMax = {} exceeds half the box length {}, the minimum image would be ambiguous.",
+                            rMax, length));
+                }
+            }
+        }
+        neighborList = std::make_unique<NeighborList>(System::boxSize, rMax);
+        inverseBinWidth = static_cast<dtype>(nBins) / rMax;
+        for (std::size_t bin = 0; bin < nBins; ++bin) {
+            shellVolumes.push_back(detail::ballVolume<System::DIM>(static_cast<dtype>(bin + 1) / inverseBinWidth)
+                                   - detail::ballVolume<System::DIM>(static_cast<dtype>(bin) / inverseBinWidth));
+        }
+    }
+
+    void begin(const typename Base::Context &context) override {
+        counts.assign(context.partition.nTasks, {});
+
+        neighborList->update(&context.particles, context.pool);
+        const auto partition = neighborList->taskPartition(context.pool);
+        histograms.resize(partition.nTasks);
+        for (auto &histogram : histograms) {
+            histogram.assign(nTypes * nTypes * nBins, 0);
+        }
+
+        const auto worker = [this, &particles = context.particles, partition](const auto &cellIndex) {
+            auto &histogram = histograms[partition(cellIndex)];
+            neighborList->forEachPairInRange(particles, cellIndex, rMax * rMax, [&](auto id1, auto id2, auto dSquared) {
+                const auto bin = static_cast<std::size_t>(std::sqrt(dSquared) * inverseBinWidth);
+                if (bin < nBins) {
+                    const std::size_t type1 = particles.typeOf(id1);
+                    const std::size_t type2 = particles.typeOf(id2);
+                    ++histogram[(type1 * nTypes + type2) * nBins + bin];
+                    ++histogram[(type2 * nTypes + type1) * nBins + bin];
+                }
+            });
+        };
+        auto futures = neighborList->forEachCell(worker, context.pool);
+        for (auto &future : futures) {
+            future.wait();
+        }
+    }
+
+    void particle(std::size_t task, std::size_t, const typename Base::Position &,
+                  const typename Base::ParticleType &type) override {
+        ++counts[task].value[type];
+    }
+
+    void end(const typename Base::Context &context) override {
+        std::array<std::uint64_t, nTypes> n {};
+        for (const auto &slot : counts) {
+            std::transform(n.begin(), n.end(), slot.value.begin(), n.begin(), std::plus<>());
+        }
+        dtype volume {1};
+        for (const auto length : System::boxSize) {
+            volume *= length;
+        }
+
+        auto frame = series_.append(context.step);
+        for (std::size_t a = 0; a < nTypes; ++a) {
+            for (std::size_t b = 0; b < nTypes; ++b) {
+                // histograms count ordered pairs
+                const auto nPartners = a == b ? n[b] - std::min<std::uint64_t>(n[b], 1) : n[b];
+                const auto nPairs = static_cast<dtype>(n[a]) * static_cast<dtype>(nPartners);
+                if (nPairs == 0) {
+                    continue;
+                }
+                for (std::size_t bin = 0; bin < nBins; ++bin) {
+                    const auto ix = (a * nTypes + b) * nBins + bin;
+                    std::uint64_t total {0};
+                    for (const auto &histogram : histograms) {
+                        total += histogram[ix];
+                    }
+                    frame[ix] = static_cast<dtype>(total) * volume / (nPairs * shellVolumes[bin]);
+                }
+            }
+        }
+    }
+
+    /**
+     * Centers of the radial bins.
+     */
+    [[nodiscard]] std::vector<dtype> radii() const {
+        std::vector<dtype> out (nBins);
+        for (std::size_t bin = 0; bin < nBins; ++bin) {
+            out[bin] = (static_cast<dtype>(bin) + static_cast<dtype>(.5)) / inverseBinWidth;
+        }
+        return out;
+    }
+
+    [[nodiscard]] const TimeSeries<dtype> &series() const {
+        return series_;
+    }
+
+private:
+    dtype rMax;
+    std::size_t nBins;
+    dtype inverseBinWidth;
+    std::vector<dtype> shellVolumes;
+    std::unique_ptr<NeighborList> neighborList;
+    // one allocation per task, so that tasks do not write to shared cache lines
+    std::vector<std::vector<std::uint64_t>> histograms;
+    std::vector<config::TaskSlot<std::array<std::uint64_t, nTypes>>> counts;
+    TimeSeries<dtype> series_;
+};
+
+/**
+ * Static structure factors S_ab(k) = Re(rho_a(k) conj(rho_b(k))) / sqrt(N_a N_b) with rho_a(k) = sum_j exp(-i k x_j)
+ * over the particles of type a, averaged over the wave vectors of the periodic box falling into shells of |k|.
+ * Frames have shape (nTypes, nTypes, nBins). Cost is linear in the number of particles times wave vectors.
+ */
+template<typename Particles, typename Pool = config::ThreadPool>
+class StructureFactor : public Observable<Particles, Pool> {
+public:
+    using Base = Observable<Particles, Pool>;
+    using dtype = typename Base::dtype;
+    using System = typename Particles::SystemType;
+    static constexpr std::size_t nTypes = System::types.size();
+    static constexpr std::size_t DIM = System::DIM;
+
+    /**
+     * @param stride evaluate every stride steps
+     * @param capacity number of frames to preallocate
+     * @param kMax the largest wave number
+     * @param nBins number of shells evenly dividing (0, kMax]
+     */
+    StructureFactor(std::size_t stride, std::size_t capacity, dtype kMax, std::size_t nBins)
+            : Base(stride), kMax(kMax), nBins(nBins), series_(capacity, {nTypes, nTypes, nBins}) {
+        if (!(kMax > 0)) {
+            throw std::invalid_argument(fmt::format("kMax must be positive, got {}.", kMax));
+        }
+        if (nBins == 0) {
+            throw std::invalid_argument("Structure factor needs at least one shell.");
+        }
+        std::array<dtype, DIM> unit {};
+        std::array<int, DIM> nMax {};
+        for (std::size_t d = 0; d < DIM; ++d) {
+            unit[d] = 2 * std::numbers::pi_v<dtype> / System::boxSize[d];
+            nMax[d] = static_cast<int>(std::floor(kMax / unit[d]));
+        }
+        // enumerate the integer lattice in [-nMax, nMax], keeping one of each pair of k and -k
+        std::array<int, DIM> n {};
+        for (std::size_t d = 0; d < DIM; ++d) {
+            n[d] = -nMax[d];
+        }
+        while (true) {
+            typename Base::Position k {};
+            for (std::size_t d = 0; d < DIM; ++d) {
+                k[d] = static_cast<dtype>(n[d]) * unit[d];
+            }
+            const auto firstNonZero = std::find_if(n.begin(), n.end(), [](int x) { return x != 0; });
+            const auto norm = std::sqrt(k.normSquared());
+            if (firstNonZero != n.end() && *firstNonZero > 0 && norm <= kMax) {
+                waveVectors.push_back(k);
+                shells.push_back(std::min(static_cast<std::size_t>(norm / kMax * static_cast<dtype>(nBins)),
+                                          nBins - 1));
+            }
+            std::size_t d = 0;
+            while (d < DIM && n[d] == nMax[d]) {
+                n[d] = -nMax[d];
+                ++d;
+            }
+            if (d == DIM) {
+                break;
+            }
+            ++n[d];
+        }
+        shellSizes.assign(nBins, 0);
+        for (const auto shell : shells) {
+            ++shellSizes[shell];
+        }
+    }
+
+    void begin(const typename Base::Context &context) override {
+        slots.resize(context.partition.nTasks);
+        for (auto &slot : slots) {
+            slot.densities.assign(nTypes * waveVectors.size(), {});
+            slot.counts.fill(0);
+        }
+    }
+
+    void particle(std::size_t task, std::size_t, const typename Base::Position &pos,
+                  const typename Base::ParticleType &type) override {
+        auto &slot = slots[task];
+        auto *densities = slot.densities.data() + type * waveVectors.size();
+        for (std::size_t i = 0; i < waveVectors.size(); ++i) {
+            dtype phase {0};
+            for (std::size_t d = 0; d < DIM; ++d) {
+                phase += waveVectors[i][d] * pos[d];
+            }
+            densities[i] += std::complex<dtype>(std::cos(phase), -std::sin(phase));
+        }
+        ++slot.counts[type];
+    }
+
+    void end(const typename Base::Context &context) override {
+        const auto nK = waveVectors.size();
+        std::vector<std::complex<dtype>> densities (nTypes * nK);
+        std::array<std::uint64_t, nTypes> n {};
+        for (const auto &slot : slots) {
+            std::transform(densities.begin(), densities.end(), slot.densities.begin(), densities.begin(),
+                           std::plus<>());
+            std::transform(n.begin(), n.end(), slot.counts.begin(), n.begin(), std::plus<>());
+        }
+
+        auto frame = series_.append(context.step);
+        for (std::size_t a = 0; a < nTypes; ++a) {
+            for (std::size_t b = 0; b < nTypes; ++b) {
+                if (n[a] == 0 || n[b] == 0) {
+                    continue;
+                }
+                const auto normalization = std::sqrt(static_cast<dtype>(n[a]) * static_cast<dtype>(n[b]));
+                auto *out = frame.data() + (a * nTypes + b) * nBins;
+                for (std::size_t i = 0; i < nK; ++i) {
+                    out[shells[i]] += std::real(densities[a * nK + i] * std::conj(densities[b * nK + i]))
+                                      / normalization;
+                }
+                for (std::size_t bin = 0; bin < nBins; ++bin) {
+                    if (shellSizes[bin] > 0) {
+                        out[bin] /= static_cast<dtype>(shellSizes[bin]);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Centers of the wave number shells, shells without any wave vector of the box record zero.
+     */
+    [[nodiscard]] std::vector<dtype> wavenumbers() const {
+        std::vector<dtype> out (nBins);
+        for (std::size_t bin = 0; bin < nBins; ++bin) {
+            out[bin] = (static_cast<dtype>(bin) + static_cast<dtype>(.5)) * kMax / static_cast<dtype>(nBins);
+        }
+        return out;
+    }
+
+    [[nodiscard]] const TimeSeries<dtype> &series() const {
+        return series_;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::vector<std::complex<dtype>> densities;
+        std::array<std::uint64_t, nTypes> counts;
+    };
+
+    dtype kMax;
+    std::size_t nBins;
+    std::vector<typename Base::Position> waveVectors;
+    std::vector<std::size_t> shells;
+    std::vector<std::size_t> shellSizes;
+    std::vector<Slot> slots;
+    TimeSeries<dtype> series_;
+};
+
+}
@@ -4,52 +4,111 @@
 
 #pragma once
 
+#include <algorithm>
 #include <tuple>
 #include <vector>
 #include <unordered_map>
 #include <list>
 #include <memory>
+#include <limits>
 
 #include <spdlog/spdlog.h>
 #include <tsl/robin_map.h>
 
+#include <ctiprd/config.h>
 #include <ctiprd/util/ops.h>
 #include <ctiprd/util/hash.h>
 #include <ctiprd/util/pbc.h>
 #include <ctiprd/reactions/doi.h>
+#include <ctiprd/util/distribution_utils.h>
 
 namespace ctiprd::cpu::reactions::impl {
 
+namespace detail {
+
+using Generator = config::DefaultGenerator;
+
+/**
+ * Computes the acceptance threshold on raw generator output for an event that happens with probability
+ * 1 - exp(-rate * tau), so that the acceptance test reduces to a single integer comparison.
+ *
+ * @param rate the reaction rate
+ * @param tau the time step
+ * @return threshold t such that a draw g() - Generator::min() < t is accepted
+ */
+template<typename dtype>
+[[nodiscard]] std::uint64_t acceptanceThreshold(const dtype &rate, const dtype &tau) {
+    static constexpr auto range = static_cast<long double>(Generator::max() - Generator::min()) + 1.L;
+    const auto threshold = (1.L - std::exp(-static_cast<long double>(rate) * static_cast<long double>(tau))) * range;
+    if (threshold >= static_cast<long double>(std::numeric_limits<std::uint64_t>::max())) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return static_cast<std::uint64_t>(threshold);
+}
+
+[[nodiscard]] inline bool shouldPerform(const std::uint64_t &threshold) {
+    return static_cast<std::uint64_t>(rnd::staticThreadLocalGenerator<Generator>()() - Generator::min()) < threshold;
+}
+
+}
+
 template<typename Updater>
 struct ReactionO1 {
     using dtype = typename Updater::dtype;
     using State = typename Updater::Position;
-    [[nodiscard]] virtual bool shouldPerform([[maybe_unused]] const dtype &tau) const {
-        return false;
-    };
+
+    virtual ~ReactionO1() = default;
+
+    /**
+     * Refreshes the cached acceptance threshold, only needs to be called when the time step changes.
+     * @param tau the time step
+     */
+    void updateProbability(const dtype &tau) {
+        threshold = detail::acceptanceThreshold(rate, tau);
+    }
+
+    [[nodiscard]] bool shouldPerform() const {
+        return detail::shouldPerform(threshold);
+    }
 
     virtual void operator()(std::size_t particleId, typename Updater::Particles &collection, Updater &updater) const {}
+
+    dtype rate {};
+    std::uint64_t threshold {};
+    // position of the reaction in System::ReactionsO1
+    std::size_t index {};
 };
 
 template<typename Updater>
 struct ReactionO2 {
     using dtype = typename Updater::dtype;
     using State = typename Updater::Position;
-    [[nodiscard]] virtual bool shouldPerform([[maybe_unused]] const dtype &tau) const { return false; };
+
+    virtual ~ReactionO2() = default;
+
+    /**
+     * Refreshes the cached acceptance threshold, only needs to be called when the time step changes.
+     * @param tau the time step
+     */
+    void updateProbability(const dtype &tau) {
+        threshold = detail::acceptanceThreshold(rate, tau);
+    }
+
+    [[nodiscard]] bool shouldPerform() const {
+        return detail::shouldPerform(threshold);
+    }
 
     virtual void operator()(std::size_t id1, std::size_t id2, typename Updater::Particles &collection, Updater &updater) const {}
 
     dtype radiusSquared {};
     dtype rate {};
+    std::uint64_t threshold {};
+    // position of the reaction in System::ReactionsO2
+    std::size_t index {};
 };
 
 namespace detail {
 
-template<typename dtype>
-[[nodiscard]] bool shouldPerform(const dtype &tau, const dtype &rate) {
-    return rnd::uniform_real<dtype>() < 1 - std::exp(-rate * tau);
-}
-
 template<typename Updater, typename Reaction>
 struct CPUReactionO1 : ReactionO1<Updater> {};
 
@@ -59,10 +118,8 @@ struct CPUReactionO1<Updater, ctiprd::reactions::doi::Decay<typename Updater::dt
     using typename ReactionO1<Updater>::dtype;
     using typename ReactionO1<Updater>::State;
 
-    explicit CPUReactionO1(const ReactionType &reaction) : baseReaction(reaction) {}
-
-    bool shouldPerform(const dtype &tau) const override {
-        return detail::shouldPerform(tau, baseReaction.rate);
+    explicit CPUReactionO1(const ReactionType &reaction) : baseReaction(reaction) {
+        ReactionO1<Updater>::rate = baseReaction.rate;
     }
 
     void operator()(std::size_t id, typename Updater::Particles &collection, Updater &updater) const override {
@@ -78,10 +135,8 @@ struct CPUReactionO1<Updater, ctiprd::reactions::doi::Conversion<typename Update
     using typename ReactionO1<Updater>::dtype;
     using typename ReactionO1<Updater>::State;
 
-    explicit CPUReactionO1(const ReactionType &reaction) : baseReaction(reaction) {}
-
-    bool shouldPerform(const dtype &tau) const override {
-        return detail::shouldPerform(tau, baseReaction.rate);
+    explicit CPUReactionO1(const ReactionType &reaction) : baseReaction(reaction) {
+        ReactionO1<Updater>::rate = baseReaction.rate;
     }
 
     void operator()(std::size_t id, typename Updater::Particles &collection, Updater &updater) const override {
@@ -97,32 +152,19 @@ struct CPUReactionO1<Updater, ctiprd::reactions::doi::Fission<typename Updater::
     using typename ReactionO1<Updater>::dtype;
     using typename ReactionO1<Updater>::State;
 
-    explicit CPUReactionO1(const ReactionType &reaction) : baseReaction(reaction) {}
-
-    bool shouldPerform(const dtype &tau) const override {
-        return detail::shouldPerform(tau, baseReaction.rate);
-    }
-
-    template<typename Generator>
-    static auto normal(Generator &generator) {
-        static std::normal_distribution<dtype> dist{0, 1};
-        return dist(generator);
-    }
-    template<typename Generator>
-    static auto uniform(Generator &generator) {
-        static std::uniform_real_distribution<dtype> dist{0, 1};
-        return dist(generator);
+    explicit CPUReactionO1(const ReactionType &reaction) : baseReaction(reaction) {
+        ReactionO1<Updater>::rate = baseReaction.rate;
     }
 
     void operator()(std::size_t id, typename Updater::Particles &collection, Updater &updater) const override {
-        const auto &c = collection.positionOf(id);
+        // copied, adding the second product may reallocate the positions
+        const auto c = collection.positionOf(id);
+        // drawn from the thread local normal buffer, whose state is part of checkpoints
         State n {};
-        std::transform(begin(n.data), end(n.data), begin(n.data), [](const auto &) {
-            return normal(rnd::staticThreadLocalGenerator());
-        });
+        std::generate(begin(n.data), end(n.data), [] { return rnd::normal<dtype, Generator>(); });
         n /= n.norm();
 
-        const auto distance = baseReaction.productDistance * std::pow(uniform(rnd::staticThreadLocalGenerator()), 1./Updater::dim);
+        const auto distance = baseReaction.productDistance * std::pow(rnd::uniform_real<dtype, Generator>(), 1./Updater::dim);
         updater.add(baseReaction.productType2, c - 0.5 * distance * n, collection);
         updater.directUpdate(id, baseReaction.productType1, c + 0.5 * distance * n, collection);
     }
@@ -142,10 +184,7 @@ struct CPUReactionO2<Updater, ctiprd::reactions::doi::Fusion<typename Updater::d
 
     explicit CPUReactionO2(const ReactionType &reaction) : baseReaction(reaction) {
         Super::radiusSquared = baseReaction.reactionRadius * baseReaction.reactionRadius;
-    }
-
-    bool shouldPerform(const dtype &tau) const override {
-        return detail::shouldPerform(tau, baseReaction.rate);
+        Super::rate = baseReaction.rate;
     }
 
     [[nodiscard]] auto key() const {
@@ -158,7 +197,8 @@ struct CPUReactionO2<Updater, ctiprd::reactions::doi::Fusion<typename Updater::d
                 auto w1 = collection.typeOf(id1) == baseReaction.eductType1 ? baseReaction.w1 : baseReaction.w2;
                 updater.template directUpdate<false>(
                         id1, baseReaction.productType,
-                        collection.positionOf(id1) + w1 * (collection.positionOf(id2) - collection.positionOf(id1)),
+                        collection.positionOf(id1) + w1 * util::pbc::shortestDifference<typename Updater::System>(
+                                collection.positionOf(id1), collection.positionOf(id2)),
                         collection
                 );
                 updater.template remove<false>(id2, collection);
@@ -180,10 +220,7 @@ struct CPUReactionO2<Updater, ctiprd::reactions::doi::Catalysis<typename Updater
 
     explicit CPUReactionO2(const ReactionType &reaction) : baseReaction(reaction) {
         Super::radiusSquared = baseReaction.reactionRadius * baseReaction.reactionRadius;
-    }
-
-    bool shouldPerform(const dtype &tau) const override {
-        return detail::shouldPerform(tau, baseReaction.rate);
+        Super::rate = baseReaction.rate;
     }
 
     [[nodiscard]] auto key() const {
@@ -236,6 +273,7 @@ std::tuple<ReactionsO1Map<Updater>, ReactionsO1Backing<Updater>> generateMapO1(c
             using ReactionType = std::tuple_element_t<I, typename System::ReactionsO1>;
             backingData.push_back(std::make_unique<detail::CPUReactionO1<Updater, ReactionType>>(reaction));
             const auto &ref = backingData.back();
+            ref->index = I;
             map[reaction.eductType].push_back(ref.get());
         }(std::get<I>(system.reactionsO1)), ...);
     }(std::make_index_sequence<std::tuple_size_v<typename System::ReactionsO1>>{});
@@ -264,6 +302,7 @@ std::tuple<ReactionsO2Map<Updater>, ReactionsO2Backing<Updater>> generateMapO2(c
             using ReactionImpl = detail::CPUReactionO2<Updater, ReactionType>;
             backingData.push_back(std::make_unique<ReactionImpl>(reaction));
             const auto &ref = backingData.back();
+            ref->index = I;
             map[ReactionImpl{reaction}.key()].push_back(ref.get());
         }(std::get<I>(system.reactionsO2)), ...);
     }(std::make_index_sequence<std::tuple_size_v<typename System::ReactionsO2>>{});
@@ -0,0 +1,436 @@
+/**
+ * @file Checkpoint.h
+ * @brief Binary checkpoints of the full simulation state, written and read in parallel chunks.
+ *
+ * A checkpoint consists of
+ *   - a CheckpointHeader,
+ *   - the blank slots in reuse order (nBlanks x uint64),
+ *   - the integrator state (stateBytes, see e.g. EulerMaruyama::State),
+ *   - the random number generator states (rngBytes): the calling thread's first, then one per pool thread, each as
+ *     uint64 length followed by the textual state of generator and normal buffer,
+ *   - positions (nSlots x DIM x dtype), types (nSlots x ParticleType), if present forces and velocities
+ *     (nSlots x DIM x dtype each) and images (nSlots x DIM x int32), every section padded to a multiple of 8 bytes.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <latch>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <ctiprd/config.h>
+#include <ctiprd/util/distribution_utils.h>
+#include <ctiprd/io/TrajectoryFormat.h>
+
+namespace ctiprd::io {
+
+namespace checkpoint {
+static constexpr std::uint32_t forces = 1U;
+static constexpr std::uint32_t velocities = 2U;
+static constexpr std::uint32_t images = 4U;
+}
+
+struct CheckpointHeader {
+    std::array<char, 8> magic {'C', 'T', 'I', 'P', 'R', 'D', 'C', 'P'};
+    std::uint32_t version {1};
+    std::uint32_t dim {};
+    std::uint32_t dtypeSize {};
+    std::uint32_t typeSize {};
+    std::uint32_t nTypes {};
+    std::uint32_t contents {};
+    std::uint64_t nSlots {};
+    std::uint64_t nBlanks {};
+    std::uint64_t nSteps {};
+    std::uint64_t stateBytes {};
+    std::uint64_t rngBytes {};
+    std::uint64_t nThreads {};
+
+    [[nodiscard]] bool valid() const {
+        return std::memcmp(magic.data(), CheckpointHeader{}.magic.data(), magic.size()) == 0;
+    }
+};
+static_assert(sizeof(CheckpointHeader) == 80);
+
+namespace detail {
+
+/**
+ * Closes a POSIX file descriptor on scope exit.
+ */
+class FileDescriptor {
+public:
+    FileDescriptor(const std::filesystem::path &path, int flags) : fd(::open(path.c_str(), flags, 0644)) {
+        if (fd < 0) {
+            throw std::runtime_error(fmt::format("Could not open checkpoint {}.", path.string()));
+        }
+    }
+
+    ~FileDescriptor() {
+        ::close(fd);
+    }
+
+    FileDescriptor(const FileDescriptor &) = delete;
+    FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+    void write(const void *data, std::size_t nBytes, std::uint64_t offset) const {
+        const auto *bytes = static_cast<const char *>(data);
+        while (nBytes > 0) {
+            const auto written = ::pwrite(fd, bytes, nBytes, static_cast<off_t>(offset));
+            if (written <= 0) {
+                throw std::runtime_error("Failed to write checkpoint.");
+            }
+            bytes += written;
+            nBytes -= static_cast<std::size_t>(written);
+            offset += static_cast<std::uint64_t>(written);
+        }
+    }
+
+    void read(void *data, std::size_t nBytes, std::uint64_t offset) const {
+        auto *bytes = static_cast<char *>(data);
+        while (nBytes > 0) {
+            const auto nRead = ::pread(fd, bytes, nBytes, static_cast<off_t>(offset));
+            if (nRead <= 0) {
+                throw std::runtime_error("Failed to read checkpoint, file is truncated.");
+            }
+            bytes += nRead;
+            nBytes -= static_cast<std::size_t>(nRead);
+            offset += static_cast<std::uint64_t>(nRead);
+        }
+    }
+
+private:
+    int fd;
+};
+
+/**
+ * Runs f(i) exactly once on each thread of the pool, i enumerating the threads in the order they picked up the task.
+ * The tasks hold each other at a latch, so no thread can pick up two of them.
+ */
+template<typename Pool, typename F>
+void onEachThread(config::PoolPtr<Pool> pool, F &&f) {
+    const auto nThreads = static_cast<std::size_t>(pool->size());
+    std::latch allRunning {static_cast<std::ptrdiff_t>(nThreads)};
+    std::atomic<std::size_t> counter {0};
+    std::vector<std::future<void>> futures;
+    futures.reserve(nThreads);
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        futures.push_back(pool->push([&]() {
+            allRunning.arrive_and_wait();
+            f(counter++);
+        }));
+    }
+    for (auto &future : futures) {
+        future.get();
+    }
+}
+
+/**
+ * Textual state of the calling thread's random number generators and buffered normal variates.
+ */
+template<typename Generator, typename dtype>
+std::string threadRngState() {
+    std::ostringstream os;
+    os << rnd::staticThreadLocalGenerator<Generator>() << ' ' << rnd::staticThreadLocalNormalBuffer<dtype>();
+    if constexpr(!std::is_same_v<Generator, config::DefaultGenerator>) {
+        os << ' ' << rnd::staticThreadLocalGenerator<config::DefaultGenerator>();
+    }
+    return os.str();
+}
+
+template<typename Generator, typename dtype>
+void restoreThreadRngState(const std::string &state) {
+    std::istringstream is (state);
+    is >> rnd::staticThreadLocalGenerator<Generator>() >> rnd::staticThreadLocalNormalBuffer<dtype>();
+    if constexpr(!std::is_same_v<Generator, config::DefaultGenerator>) {
+        is >> rnd::staticThreadLocalGenerator<config::DefaultGenerator>();
+    }
+    if (is.fail()) {
+        throw std::runtime_error("Malformed random number generator state in checkpoint.");
+    }
+}
+
+template<typename T>
+void appendBytes(const T &value, std::vector<char> &out) {
+    const auto *bytes = reinterpret_cast<const char *>(&value);
+    out.insert(end(out), bytes, bytes + sizeof(T));
+}
+
+/**
+ * Byte offsets of the per-slot sections.
+ */
+template<typename Particles>
+struct SlotSections {
+    using dtype = typename Particles::dtype;
+    static constexpr std::size_t DIM = Particles::dim;
+    static constexpr std::size_t vecBytes = DIM * sizeof(dtype);
+    static constexpr std::size_t imageBytes = sizeof(typename Particles::Image);
+    static_assert(sizeof(typename Particles::Position) == vecBytes, "Vectors are read and written as raw bytes.");
+
+    SlotSections(std::uint64_t begin, std::uint64_t nSlots)
+            : positions(begin),
+              types(positions + padded(nSlots * vecBytes)),
+              forces(types + padded(nSlots * sizeof(typename Particles::ParticleType))),
+              velocities(forces + (Particles::containsForces() ? padded(nSlots * vecBytes) : 0)),
+              images(velocities + (Particles::containsVelocities() ? padded(nSlots * vecBytes) : 0)) {}
+
+    std::uint64_t positions;
+    std::uint64_t types;
+    std::uint64_t forces;
+    std::uint64_t velocities;
+    std::uint64_t images;
+};
+
+}
+
+/**
+ * Writes a checkpoint of the integrator, its particles and the random number generators of the calling thread and all
+ * pool threads. Particle data is written in parallel chunks.
+ *
+ * Continuing from the checkpoint reproduces the original run bit by bit if the pool has a single thread: with more
+ * threads, the assignment of particle chunks to threads (and hence to generators) is not deterministic to begin with.
+ *
+ * @param path the checkpoint file
+ * @param integrator the integrator
+ * @param pool the integrator's thread pool
+ */
+template<typename Integrator, typename Pool>
+void saveCheckpoint(const std::filesystem::path &path, const Integrator &integrator, config::PoolPtr<Pool> pool) {
+    using Particles = typename Integrator::Particles;
+    using dtype = typename Particles::dtype;
+    using ParticleType = typename Particles::ParticleType;
+    using Generator = typename Integrator::RandomGenerator;
+    using State = typename Integrator::State;
+    static_assert(std::is_trivially_copyable_v<State>);
+
+    const auto &particles = *integrator.particles();
+    const auto nSlots = particles.size();
+
+    std::vector<std::string> rngStates (1 + static_cast<std::size_t>(pool->size()));
+    rngStates[0] = detail::threadRngState<Generator, dtype>();
+    detail::onEachThread(pool, [&rngStates](std::size_t i) {
+        rngStates[1 + i] = detail::threadRngState<Generator, dtype>();
+    });
+
+    std::vector<char> head;
+    for (const auto blank : particles.blankSlots()) {
+        detail::appendBytes(static_cast<std::uint64_t>(blank), head);
+    }
+    const auto state = integrator.state();
+    detail::appendBytes(state, head);
+    const auto rngBegin = head.size();
+    for (const auto &rngState : rngStates) {
+        detail::appendBytes(static_cast<std::uint64_t>(rngState.size()), head);
+        head.insert(end(head), begin(rngState), end(rngState));
+    }
+    const auto rngBytes = head.size() - rngBegin;
+    head.resize(padded(head.size()), 0);
+
+    CheckpointHeader header {};
+    header.dim = Particles::dim;
+    header.dtypeSize = sizeof(dtype);
+    header.typeSize = sizeof(ParticleType);
+    header.nTypes = Integrator::Info::nTypes;
+    header.contents = (Particles::containsForces() ? checkpoint::forces : 0U)
+                      | (Particles::containsVelocities() ? checkpoint::velocities : 0U)
+                      | (Particles::containsImages() ? checkpoint::images : 0U);
+    header.nSlots = nSlots;
+    header.nBlanks = particles.blankSlots().size();
+    header.nSteps = integrator.nSteps();
+    header.stateBytes = sizeof(State);
+    header.rngBytes = rngBytes;
+    header.nThreads = rngStates.size() - 1;
+
+    detail::FileDescriptor file {path, O_WRONLY | O_CREAT | O_TRUNC};
+    file.write(&header, sizeof(header), 0);
+    file.write(head.data(), head.size(), sizeof(header));
+
+    const detail::SlotSections<Particles> sections {sizeof(header) + head.size(), nSlots};
+    const auto granularity = config::threadGranularity(pool);
+    const auto grainSize = (nSlots + granularity - 1) / granularity;
+    std::vector<std::future<void>> futures;
+    for (std::size_t first = 0; first < nSlots; first += grainSize) {
+        const auto last = std::min<std::size_t>(first + grainSize, nSlots);
+        futures.push_back(pool->push([&particles, &file, &sections, first, last]() {
+            constexpr auto vecBytes = detail::SlotSections<Particles>::vecBytes;
+            std::vector<dtype> buffer ((last - first) * Particles::dim, 0);
+            for (auto i = first; i < last; ++i) {
+                if (particles.exists(i)) {
+                    const auto &pos = particles.positionOf(i);
+                    std::copy(begin(pos.data), end(pos.data), begin(buffer) + Particles::dim * (i - first));
+                }
+            }
+            file.write(buffer.data(), buffer.size() * sizeof(dtype), sections.positions + first * vecBytes);
+            file.write(particles.types().data() + first, (last - first) * sizeof(ParticleType),
+                       sections.types + first * sizeof(ParticleType));
+            if constexpr(Particles::containsForces()) {
+                file.write(particles.forces().data() + first, (last - first) * vecBytes,
+                           sections.forces + first * vecBytes);
+            }
+            if constexpr(Particles::containsVelocities()) {
+                file.write(particles.velocities().data() + first, (last - first) * vecBytes,
+                           sections.velocities + first * vecBytes);
+            }
+            if constexpr(Particles::containsImages()) {
+                constexpr auto imageBytes = detail::SlotSections<Particles>::imageBytes;
+                file.write(particles.images().data() + first, (last - first) * imageBytes,
+                           sections.images + first * imageBytes);
+            }
+        }));
+    }
+    for (auto &future : futures) {
+        future.get();
+    }
+}
+
+/**
+ * Restores a checkpoint written by saveCheckpoint into an integrator of the same system. If the pool size differs
+ * from the one at the time of writing, generator states are restored for as many threads as possible.
+ *
+ * @param path the checkpoint file
+ * @param integrator the integrator
+ * @param pool the integrator's thread pool
+ */
+template<typename Integrator, typename Pool>
+void loadCheckpoint(const std::filesystem::path &path, Integrator &integrator, config::PoolPtr<Pool> pool) {
+    using Particles = typename Integrator::Particles;
+    using dtype = typename Particles::dtype;
+    using ParticleType = typename Particles::ParticleType;
+    using Generator = typename Integrator::RandomGenerator;
+    using State = typename Integrator::State;
+
+    detail::FileDescriptor file {path, O_RDONLY};
+    CheckpointHeader header {};
+    file.read(&header, sizeof(header), 0);
+    if (!header.valid()) {
+        throw std::runtime_error(fmt::format("{} is not a checkpoint.", path.string()));
+    }
+    if (header.version != CheckpointHeader{}.version) {
+        throw std::runtime_error(fmt::format("Checkpoint {} has unsupported version {}.", path.string(),
+                                             header.version));
+    }
+    const auto contents = (Particles::containsForces() ? checkpoint::forces : 0U)
+                          | (Particles::containsVelocities() ? checkpoint::velocities : 0U)
+                          | (Particles::containsImages() ? checkpoint::images : 0U);
+    if (header.dim != Particles::dim || header.dtypeSize != sizeof(dtype) || header.typeSize != sizeof(ParticleType)
+        || header.nTypes != Integrator::Info::nTypes || header.contents != contents
+        || header.stateBytes != sizeof(State)) {
+        throw std::runtime_error(fmt::format("Checkpoint {} was written for a different system or integrator.",
+                                             path.string()));
+    }
+
+    std::vector<char> head (padded(header.nBlanks * sizeof(std::uint64_t) + header.stateBytes + header.rngBytes));
+    file.read(head.data(), head.size(), sizeof(header));
+    const auto *it = head.data();
+
+    std::vector<typename Particles::size_type> blanks (header.nBlanks);
+    for (auto &blank : blanks) {
+        std::uint64_t value;
+        std::memcpy(&value, it, sizeof(value));
+        blank = value;
+        it += sizeof(value);
+    }
+    State state {};
+    std::memcpy(&state, it, sizeof(State));
+    it += sizeof(State);
+
+    // every state is at least its length field
+    if (header.nThreads >= header.rngBytes / sizeof(std::uint64_t)) {
+        throw std::runtime_error(fmt::format("Malformed random number generator states in checkpoint {}.",
+                                             path.string()));
+    }
+    const auto *rngEnd = it + header.rngBytes;
+    std::vector<std::string> rngStates (header.nThreads + 1);
+    for (auto &rngState : rngStates) {
+        std::uint64_t length;
+        if (static_cast<std::size_t>(rngEnd - it) < sizeof(length)) {
+            throw std::runtime_error(fmt::format("Malformed random number generator states in checkpoint {}.",
+                                                 path.string()));
+        }
+        std::memcpy(&length, it, sizeof(length));
+        it += sizeof(length);
+        if (length > static_cast<std::uint64_t>(rngEnd - it)) {
+            throw std::runtime_error(fmt::format("Malformed random number generator states in checkpoint {}.",
+                                                 path.string()));
+        }
+        rngState.assign(it, length);
+        it += length;
+    }
+
+    if (header.nThreads != static_cast<std::uint64_t>(pool->size())) {
+        spdlog::warn("Checkpoint was written with {} threads but the pool has {}, the continued run will not "
+                     "reproduce the original one.", header.nThreads, pool->size());
+    }
+    detail::restoreThreadRngState<Generator, dtype>(rngStates[0]);
+    detail::onEachThread(pool, [&rngStates](std::size_t i) {
+        if (1 + i < rngStates.size()) {
+            detail::restoreThreadRngState<Generator, dtype>(rngStates[1 + i]);
+        }
+    });
+    integrator.restore(state);
+
+    auto &particles = *integrator.particles();
+    const auto nSlots = header.nSlots;
+    particles.assignSlots(nSlots, std::move(blanks));
+
+    const detail::SlotSections<Particles> sections {sizeof(header) + head.size(), nSlots};
+    const auto granularity = config::threadGranularity(pool);
+    const auto grainSize = (nSlots + granularity - 1) / granularity;
+    std::vector<std::future<void>> futures;
+    for (std::size_t first = 0; first < nSlots; first += grainSize) {
+        const auto last = std::min<std::size_t>(first + grainSize, nSlots);
+        futures.push_back(pool->push([&particles, &file, &sections, first, last]() {
+            constexpr auto vecBytes = detail::SlotSections<Particles>::vecBytes;
+            const auto n = last - first;
+            std::vector<typename Particles::Position> vecs (n);
+            std::vector<ParticleType> types (n);
+
+            file.read(vecs.data(), n * vecBytes, sections.positions + first * vecBytes);
+            file.read(types.data(), n * sizeof(ParticleType), sections.types + first * sizeof(ParticleType));
+            for (auto i = first; i < last; ++i) {
+                if (particles.exists(i)) {
+                    particles.setPosition(i, vecs[i - first]);
+                }
+                particles.setType(i, types[i - first]);
+            }
+            if constexpr(Particles::containsForces()) {
+                file.read(vecs.data(), n * vecBytes, sections.forces + first * vecBytes);
+                for (auto i = first; i < last; ++i) {
+                    particles.setForce(i, vecs[i - first]);
+                }
+            }
+            if constexpr(Particles::containsVelocities()) {
+                file.read(vecs.data(), n * vecBytes, sections.velocities + first * vecBytes);
+                for (auto i = first; i < last; ++i) {
+                    particles.setVelocity(i, vecs[i - first]);
+                }
+            }
+            if constexpr(Particles::containsImages()) {
+                constexpr auto imageBytes = detail::SlotSections<Particles>::imageBytes;
+                std::vector<typename Particles::Image> images (n);
+                file.read(images.data(), n * imageBytes, sections.images + first * imageBytes);
+                for (auto i = first; i < last; ++i) {
+                    particles.setImage(i, images[i - first]);
+                }
+            }
+        }));
+    }
+    for (auto &future : futures) {
+        future.get();
+    }
+}
+
+}
@@ -0,0 +1,364 @@
+/**
+ * @file TrajectoryCodec.h
+ * @brief Quantized delta encoding of trajectory frames, see TrajectoryFormat.h for the layout.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <ctiprd/io/TrajectoryFormat.h>
+#include <ctiprd/io/TrajectoryReader.h>
+
+namespace ctiprd::io {
+
+/**
+ * Options of the quantized encoding.
+ */
+struct QuantizationOptions {
+    /**
+     * Quantization step relative to the box size, positions are reproduced up to precision * boxSize / 2 per axis.
+     */
+    double precision {1e-4};
+    /**
+     * Every keyframeInterval-th frame is coded without reference to its predecessor, bounding the cost of seeking.
+     */
+    std::size_t keyframeInterval {64};
+};
+
+namespace detail {
+
+inline void putVarint(std::uint64_t value, std::vector<char> &out) {
+    while (value >= 0x80U) {
+        out.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+        value >>= 7U;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline std::uint64_t getVarint(const std::byte *&it, const std::byte *end) {
+    std::uint64_t value {0};
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (it == end) {
+            throw std::runtime_error("Truncated varint in quantized trajectory frame.");
+        }
+        const auto byte = static_cast<std::uint64_t>(*it++);
+        value |= (byte & 0x7FU) << shift;
+        if ((byte & 0x80U) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Malformed varint in quantized trajectory frame.");
+}
+
+constexpr std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1U) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+constexpr std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1U) ^ -static_cast<std::int64_t>(value & 1U);
+}
+
+}
+
+/**
+ * Encodes snapshots of the particle slots (positions and types, blank slots carrying the type nTypes) into quantized
+ * frame payloads. The encoder keeps the quantized previous frame to code differences per slot.
+ */
+template<typename dtype, typename ParticleType, std::size_t DIM>
+class QuantizedEncoder {
+public:
+    QuantizedEncoder(const std::array<dtype, DIM> &boxSize, std::size_t nTypes, QuantizationOptions options)
+            : nTypes(nTypes), keyframeInterval(std::max<std::size_t>(options.keyframeInterval, 1)) {
+        if (!(options.precision > 0)) {
+            throw std::invalid_argument(fmt::format("Quantization precision must be positive, got {}.",
+                                                    options.precision));
+        }
+        for (std::size_t d = 0; d < DIM; ++d) {
+            axes_[d] = {.origin = -.5 * boxSize[d], .step = options.precision * boxSize[d]};
+        }
+    }
+
+    [[nodiscard]] const std::array<QuantizationAxis, DIM> &axes() const {
+        return axes_;
+    }
+
+    /**
+     * Appends the payload of the next frame to out, padded to a multiple of 8 bytes.
+     *
+     * @param positions slot positions, DIM per slot
+     * @param types slot types
+     * @param out output buffer
+     * @return number of payload bytes written
+     */
+    std::uint64_t encode(std::span<const dtype> positions, std::span<const ParticleType> types,
+                         std::vector<char> &out) {
+        const auto start = out.size();
+        const auto nSlots = types.size();
+        const bool keyframe = nEncoded % keyframeInterval == 0;
+        ++nEncoded;
+
+        detail::putVarint(nSlots, out);
+
+        runs.clear();
+        for (std::size_t i = 0; i < nSlots;) {
+            auto j = i + 1;
+            while (j < nSlots && types[j] == types[i]) {
+                ++j;
+            }
+            runs.emplace_back(types[i], j - i);
+            i = j;
+        }
+        detail::putVarint(runs.size(), out);
+        for (const auto &[type, length] : runs) {
+            detail::putVarint(type, out);
+            detail::putVarint(length, out);
+        }
+
+        if (previous.size() < nSlots * DIM) {
+            previous.resize(nSlots * DIM, 0);
+            previousValid.resize(nSlots, false);
+        }
+        for (std::size_t i = 0; i < nSlots; ++i) {
+            const bool valid = types[i] < nTypes;
+            if (valid) {
+                const bool reference = !keyframe && previousValid[i];
+                for (std::size_t d = 0; d < DIM; ++d) {
+                    const auto q = std::llround((positions[DIM * i + d] - axes_[d].origin) / axes_[d].step);
+                    detail::putVarint(detail::zigzag(q - (reference ? previous[DIM * i + d] : 0)), out);
+                    previous[DIM * i + d] = q;
+                }
+            }
+            previousValid[i] = valid;
+        }
+        std::fill(begin(previousValid) + static_cast<std::ptrdiff_t>(nSlots), end(previousValid), false);
+
+        out.resize(start + padded(out.size() - start), 0);
+        return out.size() - start;
+    }
+
+private:
+    std::size_t nTypes;
+    std::size_t keyframeInterval;
+    std::size_t nEncoded {0};
+    std::array<QuantizationAxis, DIM> axes_ {};
+    std::vector<std::int64_t> previous {};
+    std::vector<bool> previousValid {};
+    std::vector<std::pair<ParticleType, std::size_t>> runs {};
+};
+
+/**
+ * Decodes quantized frame payloads in order. Like the encoder it keeps the previous frame's quantized slots.
+ */
+class QuantizedDecoder {
+public:
+    QuantizedDecoder(std::size_t dim, std::size_t nTypes, std::vector<QuantizationAxis> axes)
+            : dim(dim), nTypes(nTypes), axes(std::move(axes)) {}
+
+    /**
+     * Decodes the next payload.
+     *
+     * @param payload begin of the payload
+     * @param nBytes payload size
+     * @param keyframe whether the frame was coded without reference
+     */
+    void decode(const std::byte *payload, std::size_t nBytes, bool keyframe) {
+        const auto *it = payload;
+        const auto *end = payload + nBytes;
+        const auto nSlots = detail::getVarint(it, end);
+
+        const auto previousSlots = slotTypes.size();
+        slotTypes.resize(nSlots);
+        quantized.resize(nSlots * dim, 0);
+        previousValid.resize(nSlots, false);
+        for (std::size_t i = 0; i < std::min<std::size_t>(previousSlots, nSlots); ++i) {
+            previousValid[i] = slotTypes[i] < nTypes;
+        }
+        std::fill(begin(previousValid) + static_cast<std::ptrdiff_t>(std::min<std::size_t>(previousSlots, nSlots)),
+                  std::end(previousValid), false);
+
+        const auto nRuns = detail::getVarint(it, end);
+        std::size_t slot {0};
+        for (std::size_t r = 0; r < nRuns; ++r) {
+            const auto type = detail::getVarint(it, end);
+            const auto length = detail::getVarint(it, end);
+            if (slot + length > nSlots) {
+                throw std::runtime_error("Type runs exceed the number of slots in quantized trajectory frame.");
+            }
+            std::fill_n(begin(slotTypes) + static_cast<std::ptrdiff_t>(slot), length, type);
+            slot += length;
+        }
+        if (slot != nSlots) {
+            throw std::runtime_error("Type runs do not cover all slots in quantized trajectory frame.");
+        }
+
+        for (std::size_t i = 0; i < nSlots; ++i) {
+            if (slotTypes[i] < nTypes) {
+                const bool reference = !keyframe && previousValid[i];
+                for (std::size_t d = 0; d < dim; ++d) {
+                    const auto delta = detail::unzigzag(detail::getVarint(it, end));
+                    quantized[dim * i + d] = (reference ? quantized[dim * i + d] : 0) + delta;
+                }
+            }
+        }
+    }
+
+    /**
+     * Writes the current frame grouped by type, matching the layout of raw frames.
+     */
+    template<typename dtype, typename ParticleType>
+    void groupedByType(std::vector<dtype> &positions, std::vector<ParticleType> &types,
+                       std::vector<std::uint64_t> &counts) const {
+        counts.assign(nTypes + 1, 0);
+        for (const auto type : slotTypes) {
+            ++counts[std::min<std::uint64_t>(type, nTypes)];
+        }
+        std::vector<std::uint64_t> offsets (nTypes + 1);
+        std::exclusive_scan(begin(counts), end(counts), begin(offsets), static_cast<std::uint64_t>(0));
+        const auto nParticles = offsets[nTypes];
+        counts.resize(nTypes);
+
+        positions.resize(nParticles * dim);
+        types.resize(nParticles);
+        for (std::size_t i = 0; i < slotTypes.size(); ++i) {
+            const auto type = slotTypes[i];
+            if (type < nTypes) {
+                const auto target = offsets[type]++;
+                types[target] = static_cast<ParticleType>(type);
+                for (std::size_t d = 0; d < dim; ++d) {
+                    positions[dim * target + d] = static_cast<dtype>(
+                            axes[d].origin + axes[d].step * static_cast<double>(quantized[dim * i + d]));
+                }
+            }
+        }
+    }
+
+private:
+    std::size_t dim;
+    std::size_t nTypes;
+    std::vector<QuantizationAxis> axes;
+    std::vector<std::uint64_t> slotTypes {};
+    std::vector<std::int64_t> quantized {};
+    std::vector<bool> previousValid {};
+};
+
+/**
+ * A decoded frame, grouped by type like raw frames.
+ */
+template<typename dtype, typename ParticleType>
+struct DecodedFrame {
+    std::uint64_t step {};
+    std::vector<std::uint64_t> counts {};
+    std::vector<dtype> positions {};
+    std::vector<ParticleType> types {};
+};
+
+/**
+ * Reads quantized trajectory files. Sequential access decodes each frame once, seeking decodes from the closest
+ * preceding keyframe.
+ */
+class QuantizedTrajectoryReader {
+public:
+    explicit QuantizedTrajectoryReader(const std::filesystem::path &path) : file(path) {
+        if (file.size() < sizeof(FileHeader)) {
+            throw std::runtime_error(fmt::format("{} is not a trajectory file.", path.string()));
+        }
+        std::memcpy(&header_, file.data(), sizeof(FileHeader));
+        if (!header_.valid()) {
+            throw std::runtime_error(fmt::format("{} is not a trajectory file.", path.string()));
+        }
+        if (header_.indexOffset == 0) {
+            throw std::runtime_error(fmt::format("Trajectory file {} was not finalized.", path.string()));
+        }
+        if ((header_.flags & flags::quantized) == 0 || header_.keyframeInterval == 0) {
+            throw std::runtime_error(fmt::format("Trajectory file {} is not quantized.", path.string()));
+        }
+        if (header_.indexOffset > file.size()
+            || header_.nFrames > (file.size() - header_.indexOffset) / sizeof(FrameIndexEntry)) {
+            throw std::runtime_error(fmt::format("Frame index of {} is truncated.", path.string()));
+        }
+        const auto axesBytes = static_cast<std::uint64_t>(header_.dim) * sizeof(QuantizationAxis);
+        if (sizeof(FileHeader) + axesBytes > header_.indexOffset) {
+            throw std::runtime_error(fmt::format("Quantization axes of {} are truncated.", path.string()));
+        }
+        std::vector<QuantizationAxis> axes (header_.dim);
+        std::memcpy(axes.data(), file.data() + sizeof(FileHeader), axesBytes);
+        decoder.emplace(header_.dim, header_.nTypes, std::move(axes));
+        index_ = {reinterpret_cast<const FrameIndexEntry *>(file.data() + header_.indexOffset), header_.nFrames};
+        for (std::size_t k = 0; k < index_.size(); ++k) {
+            if (!frameInBounds(index_[k], sizeof(FileHeader) + axesBytes)) {
+                throw std::runtime_error(fmt::format("Frame {} of {} lies outside of the file.", k, path.string()));
+            }
+        }
+    }
+
+    [[nodiscard]] const FileHeader &header() const {
+        return header_;
+    }
+
+    [[nodiscard]] std::size_t nFrames() const {
+        return index_.size();
+    }
+
+    [[nodiscard]] std::span<const FrameIndexEntry> index() const {
+        return index_;
+    }
+
+    template<typename dtype, typename ParticleType>
+    [[nodiscard]] DecodedFrame<dtype, ParticleType> frame(std::size_t k) {
+        if (k >= index_.size()) {
+            throw std::out_of_range(fmt::format("Frame {} out of range for {} frames.", k, index_.size()));
+        }
+        if (sizeof(dtype) != header_.dtypeSize || sizeof(ParticleType) != header_.typeSize) {
+            throw std::runtime_error("Requested element sizes do not match the stored ones.");
+        }
+        const auto keyframe = k - k % header_.keyframeInterval;
+        auto next = (current && *current <= k && *current >= keyframe) ? *current + 1 : keyframe;
+        for (; next <= k; ++next) {
+            const auto &entry = index_[next];
+            FrameHeader frameHeader {};
+            std::memcpy(&frameHeader, file.data() + entry.offset, sizeof(FrameHeader));
+            decoder->decode(file.data() + entry.offset + sizeof(FrameHeader), frameHeader.payloadBytes,
+                            next % header_.keyframeInterval == 0);
+            current = next;
+        }
+        DecodedFrame<dtype, ParticleType> out {.step = index_[k].step};
+        decoder->groupedByType(out.positions, out.types, out.counts);
+        return out;
+    }
+
+private:
+    /**
+     * Whether the frame header and payload of an index entry lie within the file, after the given start of the frames.
+     */
+    [[nodiscard]] bool frameInBounds(const FrameIndexEntry &entry, std::uint64_t framesBegin) const {
+        if (entry.offset < framesBegin || entry.offset > file.size()
+            || file.size() - entry.offset < sizeof(FrameHeader)) {
+            return false;
+        }
+        FrameHeader frameHeader {};
+        std::memcpy(&frameHeader, file.data() + entry.offset, sizeof(FrameHeader));
+        return frameHeader.payloadBytes <= file.size() - entry.offset - sizeof(FrameHeader);
+    }
+
+    detail::MappedFile file;
+    FileHeader header_ {};
+    std::span<const FrameIndexEntry> index_ {};
+    std::optional<QuantizedDecoder> decoder {};
+    std::optional<std::size_t> current {};
+};
+
+}
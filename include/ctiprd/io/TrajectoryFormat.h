@@ -0,0 +1,93 @@
+/**
+ * @file TrajectoryFormat.h
+ * @brief On-disk layout of trajectory files.
+ *
+ * A trajectory file consists of
+ *   - a FileHeader,
+ *   - a sequence of frames, each made of a FrameHeader, the per-type particle counts (nTypes x uint64), positions
+ *     (nParticles x DIM x dtype) grouped by particle type and the matching type ids (nParticles x ParticleType),
+ *     padded to a multiple of 8 bytes,
+ *   - a frame index (nFrames x FrameIndexEntry) located at FileHeader::indexOffset.
+ * The header is patched when the file is finalized, an indexOffset of zero denotes an unfinalized file.
+ *
+ * Files with the flags::quantized bit set store one QuantizationAxis per dimension directly after the FileHeader.
+ * Their frames keep the particle slot order instead of grouping by type, the payload consists of varint coded
+ *   - the number of slots,
+ *   - the run-length coded types (number of runs, then pairs of type and run length, blank slots have type nTypes),
+ *   - the zigzag coded difference of each occupied slot's quantized coordinates to the same slot in the previous
+ *     frame, or to zero if the slot was blank or the frame is a keyframe (frame index divisible by keyframeInterval),
+ * padded to a multiple of 8 bytes.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace ctiprd::io {
+
+namespace flags {
+static constexpr std::uint32_t quantized = 1U;
+}
+
+struct FileHeader {
+    std::array<char, 8> magic {'C', 'T', 'I', 'P', 'R', 'D', 'T', 'J'};
+    std::uint32_t version {1};
+    std::uint32_t dim {};
+    std::uint32_t dtypeSize {};
+    std::uint32_t typeSize {};
+    std::uint32_t nTypes {};
+    std::uint32_t flags {};
+    std::uint64_t nFrames {};
+    std::uint64_t indexOffset {};
+    std::uint64_t keyframeInterval {};
+    std::uint64_t reserved {};
+
+    [[nodiscard]] bool valid() const {
+        return std::memcmp(magic.data(), FileHeader{}.magic.data(), magic.size()) == 0;
+    }
+};
+static_assert(sizeof(FileHeader) == 64);
+
+struct FrameHeader {
+    std::uint64_t step {};
+    std::uint64_t nParticles {};
+    std::uint64_t payloadBytes {};
+    std::uint64_t reserved {};
+};
+static_assert(sizeof(FrameHeader) == 32);
+
+struct FrameIndexEntry {
+    std::uint64_t offset {};
+    std::uint64_t step {};
+    std::uint64_t nParticles {};
+};
+static_assert(sizeof(FrameIndexEntry) == 24);
+
+/**
+ * Maps a coordinate x to the integer round((x - origin) / step).
+ */
+struct QuantizationAxis {
+    double origin {};
+    double step {};
+};
+static_assert(sizeof(QuantizationAxis) == 16);
+
+/**
+ * Rounds a number of bytes up to the next multiple of 8, keeping all arrays in the file 8-byte aligned.
+ */
+constexpr std::uint64_t padded(std::uint64_t nBytes) {
+    return (nBytes + 7) & ~static_cast<std::uint64_t>(7);
+}
+
+/**
+ * Number of payload bytes (everything after the FrameHeader) of a raw frame.
+ */
+template<typename dtype, typename ParticleType>
+constexpr std::uint64_t rawPayloadBytes(std::uint64_t nTypes, std::uint64_t dim, std::uint64_t nParticles) {
+    return nTypes * sizeof(std::uint64_t) + padded(nParticles * dim * sizeof(dtype))
+           + padded(nParticles * sizeof(ParticleType));
+}
+
+}
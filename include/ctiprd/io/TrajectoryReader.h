@@ -0,0 +1,265 @@
+/**
+ * @file TrajectoryReader.h
+ * @brief Random access to trajectory files through a read-only memory mapping.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include <ctiprd/io/TrajectoryFormat.h>
+
+namespace ctiprd::io {
+
+namespace detail {
+
+/**
+ * Owns a read-only, private memory mapping of a whole file.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path &path) {
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error(fmt::format("Could not open {} for reading.", path.string()));
+        }
+        struct stat info {};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error(fmt::format("Could not stat {}.", path.string()));
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ > 0) {
+            auto *ptr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error(fmt::format("Could not map {}.", path.string()));
+            }
+            data_ = static_cast<const std::byte *>(ptr);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<std::byte *>(data_), size_);
+        }
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept
+            : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+    MappedFile &operator=(MappedFile &&) = delete;
+
+    [[nodiscard]] const std::byte *data() const {
+        return data_;
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return size_;
+    }
+
+private:
+    const std::byte *data_ {nullptr};
+    std::size_t size_ {0};
+};
+
+}
+
+/**
+ * Untyped view into one frame of a mapped trajectory file. Positions of particles of type t are the rows
+ * [typeOffsets[t], typeOffsets[t] + counts[t]) since frames are grouped by type.
+ */
+struct FrameView {
+    std::uint64_t step {};
+    std::uint64_t nParticles {};
+    std::span<const std::uint64_t> counts {};
+    const std::byte *positions {};
+    const std::byte *types {};
+
+    /**
+     * First row of particles with the given type.
+     */
+    [[nodiscard]] std::uint64_t typeOffset(std::size_t type) const {
+        std::uint64_t offset {0};
+        for (std::size_t t = 0; t < type; ++t) {
+            offset += counts[t];
+        }
+        return offset;
+    }
+};
+
+/**
+ * Reads trajectory files written by TrajectoryWriter. The file is mapped once, the frame index is read in place so
+ * that seeking to a frame is O(1) and frames are never copied.
+ */
+class TrajectoryReader {
+public:
+    explicit TrajectoryReader(const std::filesystem::path &path) : file(path) {
+        if (file.size() < sizeof(FileHeader)) {
+            throw std::runtime_error(fmt::format("{} is not a trajectory file.", path.string()));
+        }
+        std::memcpy(&header_, file.data(), sizeof(FileHeader));
+        if (!header_.valid()) {
+            throw std::runtime_error(fmt::format("{} is not a trajectory file.", path.string()));
+        }
+        if (header_.indexOffset == 0) {
+            throw std::runtime_error(fmt::format("Trajectory file {} was not finalized.", path.string()));
+        }
+        if ((header_.flags & flags::quantized) != 0) {
+            throw std::runtime_error(fmt::format("Trajectory file {} is compressed and cannot be memory-mapped.",
+                                                 path.string()));
+        }
+        if (header_.indexOffset > file.size()
+            || header_.nFrames > (file.size() - header_.indexOffset) / sizeof(FrameIndexEntry)) {
+            throw std::runtime_error(fmt::format("Frame index of {} is truncated.", path.string()));
+        }
+        index_ = {reinterpret_cast<const FrameIndexEntry *>(file.data() + header_.indexOffset), header_.nFrames};
+        for (std::size_t k = 0; k < index_.size(); ++k) {
+            if (!frameInBounds(index_[k])) {
+                throw std::runtime_error(fmt::format("Frame {} of {} lies outside of the file.", k, path.string()));
+            }
+        }
+    }
+
+    [[nodiscard]] const FileHeader &header() const {
+        return header_;
+    }
+
+    [[nodiscard]] std::size_t nFrames() const {
+        return index_.size();
+    }
+
+    [[nodiscard]] std::span<const FrameIndexEntry> index() const {
+        return index_;
+    }
+
+    /**
+     * Views frame k.
+     */
+    [[nodiscard]] FrameView frame(std::size_t k) const {
+        if (k >= index_.size()) {
+            throw std::out_of_range(fmt::format("Frame {} out of range for {} frames.", k, index_.size()));
+        }
+        const auto &entry = index_[k];
+        const auto *countsBegin = file.data() + entry.offset + sizeof(FrameHeader);
+        const auto *positions = countsBegin + header_.nTypes * sizeof(std::uint64_t);
+        return {
+            .step = entry.step,
+            .nParticles = entry.nParticles,
+            .counts = {reinterpret_cast<const std::uint64_t *>(countsBegin), header_.nTypes},
+            .positions = positions,
+            .types = positions + padded(entry.nParticles * header_.dim * header_.dtypeSize)
+        };
+    }
+
+    /**
+     * Typed positions of frame k, optionally restricted to one particle type.
+     *
+     * @tparam dtype the floating point type the trajectory was written with
+     */
+    template<typename dtype>
+    [[nodiscard]] std::span<const dtype> positions(std::size_t k) const {
+        checkSize<dtype>(header_.dtypeSize);
+        const auto view = frame(k);
+        return {reinterpret_cast<const dtype *>(view.positions), view.nParticles * header_.dim};
+    }
+
+    template<typename dtype>
+    [[nodiscard]] std::span<const dtype> positions(std::size_t k, std::size_t type) const {
+        const auto view = frame(k);
+        checkType(type);
+        return positions<dtype>(k).subspan(view.typeOffset(type) * header_.dim, view.counts[type] * header_.dim);
+    }
+
+    /**
+     * Typed particle types of frame k, sorted ascending.
+     */
+    template<typename ParticleType>
+    [[nodiscard]] std::span<const ParticleType> types(std::size_t k) const {
+        checkSize<ParticleType>(header_.typeSize);
+        const auto view = frame(k);
+        return {reinterpret_cast<const ParticleType *>(view.types), view.nParticles};
+    }
+
+    /**
+     * Range of frames [first, last) with stepBegin <= step < stepEnd.
+     */
+    [[nodiscard]] std::pair<std::size_t, std::size_t> frameRange(std::uint64_t stepBegin,
+                                                                 std::uint64_t stepEnd) const {
+        const auto byStep = [](const FrameIndexEntry &entry, std::uint64_t step) { return entry.step < step; };
+        const auto first = std::lower_bound(begin(index_), end(index_), stepBegin, byStep);
+        const auto last = std::lower_bound(first, end(index_), std::max(stepBegin, stepEnd), byStep);
+        return {static_cast<std::size_t>(first - begin(index_)), static_cast<std::size_t>(last - begin(index_))};
+    }
+
+private:
+    /**
+     * Whether the frame header, counts and payload of an index entry lie within the file and its counts add up.
+     */
+    [[nodiscard]] bool frameInBounds(const FrameIndexEntry &entry) const {
+        if (entry.offset < sizeof(FileHeader) || entry.offset > file.size()
+            || file.size() - entry.offset < sizeof(FrameHeader)) {
+            return false;
+        }
+        const std::uint64_t available = file.size() - entry.offset - sizeof(FrameHeader);
+        const std::uint64_t countBytes = static_cast<std::uint64_t>(header_.nTypes) * sizeof(std::uint64_t);
+        const std::uint64_t particleBytes = static_cast<std::uint64_t>(header_.dim) * header_.dtypeSize
+                                            + header_.typeSize;
+        if (countBytes > available || (particleBytes > 0 && entry.nParticles > available / particleBytes)) {
+            return false;
+        }
+        const auto payload = countBytes + padded(entry.nParticles * header_.dim * header_.dtypeSize)
+                             + padded(entry.nParticles * header_.typeSize);
+        if (payload > available) {
+            return false;
+        }
+        const auto *counts = file.data() + entry.offset + sizeof(FrameHeader);
+        std::uint64_t nParticles {0};
+        for (std::size_t t = 0; t < header_.nTypes; ++t) {
+            std::uint64_t count {};
+            std::memcpy(&count, counts + t * sizeof(std::uint64_t), sizeof(count));
+            if (count > entry.nParticles - nParticles) {
+                return false;
+            }
+            nParticles += count;
+        }
+        return nParticles == entry.nParticles;
+    }
+
+    template<typename T>
+    static void checkSize(std::uint32_t size) {
+        if (sizeof(T) != size) {
+            throw std::runtime_error(fmt::format("Requested element size {} does not match stored size {}.",
+                                                 sizeof(T), size));
+        }
+    }
+
+    void checkType(std::size_t type) const {
+        if (type >= header_.nTypes) {
+            throw std::out_of_range(fmt::format("Particle type {} out of range for {} types.", type,
+                                                header_.nTypes));
+        }
+    }
+
+    detail::MappedFile file;
+    FileHeader header_ {};
+    std::span<const FrameIndexEntry> index_ {};
+};
+
+}
@@ -0,0 +1,300 @@
+/**
+ * @file TrajectoryWriter.h
+ * @brief Streams trajectory frames to disk from a background thread.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <ctiprd/config.h>
+#include <ctiprd/systems/util.h>
+#include <ctiprd/io/TrajectoryFormat.h>
+#include <ctiprd/io/TrajectoryCodec.h>
+
+namespace ctiprd::io {
+
+/**
+ * Writes frames of a simulation into a trajectory file (see TrajectoryFormat.h). Recording a frame only takes a
+ * parallel snapshot of the particle slots, grouping by type and writing happens on a background thread. Snapshots
+ * are double-buffered and encoded frames are flushed in chunks, so memory is bounded by two snapshots and one chunk.
+ * Optionally, frames are quantized and delta-coded (see QuantizedEncoder), trading bounded precision for size.
+ *
+ * @tparam System the system
+ */
+template<systems::system System>
+class TrajectoryWriter {
+public:
+    using dtype = typename System::dtype;
+    using ParticleType = systems::particle_type_t<System>;
+    static constexpr std::size_t DIM = System::DIM;
+    static constexpr std::size_t nTypes = System::types.size();
+
+    /**
+     * Opens a new trajectory file, truncating existing content.
+     *
+     * @param path path to the file
+     * @param chunkSize number of bytes after which encoded frames are flushed to disk
+     * @param quantization if given, frames are stored quantized with these options
+     */
+    explicit TrajectoryWriter(const std::filesystem::path &path, std::size_t chunkSize = 1U << 24U,
+                              std::optional<QuantizationOptions> quantization = std::nullopt)
+            : file(path, std::ios::binary | std::ios::trunc), chunkSize(chunkSize) {
+        if (!file) {
+            throw std::runtime_error(fmt::format("Could not open trajectory file {} for writing.", path.string()));
+        }
+        header.dim = DIM;
+        header.dtypeSize = sizeof(dtype);
+        header.typeSize = sizeof(ParticleType);
+        header.nTypes = nTypes;
+        if (quantization) {
+            encoder.emplace(System::boxSize, nTypes, *quantization);
+            header.flags |= flags::quantized;
+            header.keyframeInterval = std::max<std::size_t>(quantization->keyframeInterval, 1);
+        }
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        offset = sizeof(header);
+        if (encoder) {
+            file.write(reinterpret_cast<const char *>(encoder->axes().data()),
+                       static_cast<std::streamsize>(sizeof(QuantizationAxis) * DIM));
+            offset += sizeof(QuantizationAxis) * DIM;
+        }
+        chunk.reserve(chunkSize);
+
+        worker = std::thread([this] { run(); });
+    }
+
+    ~TrajectoryWriter() {
+        try {
+            close();
+        } catch (const std::exception &e) {
+            spdlog::error("Error while closing trajectory file: {}", e.what());
+        }
+    }
+
+    TrajectoryWriter(const TrajectoryWriter &) = delete;
+    TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+    TrajectoryWriter(TrajectoryWriter &&) = delete;
+    TrajectoryWriter &operator=(TrajectoryWriter &&) = delete;
+
+    /**
+     * Records the current state of the integrator's particles. Blocks only while the previous snapshot has not been
+     * picked up by the background thread yet.
+     *
+     * @param step the current step
+     * @param integrator the integrator
+     * @param pool the thread pool used to take the snapshot
+     */
+    template<typename Integrator, typename Pool>
+    void record(std::size_t step, const Integrator &integrator, config::PoolPtr<Pool> pool) {
+        const auto &particles = *integrator.particles();
+        front.step = step;
+        front.positions.resize(particles.size() * DIM);
+        front.types.resize(particles.size());
+        std::fill(begin(front.types), end(front.types), static_cast<ParticleType>(nTypes));
+
+        auto futures = integrator.particles()->forEachParticle([&snapshot = front](auto particleId, const auto &pos,
+                                                                                   const auto &type, const auto &) {
+            snapshot.types[particleId] = type;
+            std::copy(begin(pos.data), end(pos.data), begin(snapshot.positions) + DIM * particleId);
+        }, pool);
+        for (auto &future : futures) {
+            future.wait();
+        }
+
+        {
+            std::unique_lock lock{mutex};
+            cv.wait(lock, [this] { return !backPending; });
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            std::swap(front, back);
+            backPending = true;
+        }
+        cv.notify_all();
+        ++nRecorded;
+    }
+
+    /**
+     * Writes all outstanding frames, the frame index and finalizes the header. Called on destruction.
+     */
+    void close() {
+        if (!worker.joinable()) {
+            return;
+        }
+        {
+            std::scoped_lock lock{mutex};
+            stop = true;
+        }
+        cv.notify_all();
+        worker.join();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        flush();
+        header.nFrames = index.size();
+        header.indexOffset = offset;
+        file.write(reinterpret_cast<const char *>(index.data()),
+                   static_cast<std::streamsize>(index.size() * sizeof(FrameIndexEntry)));
+        file.seekp(0);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.close();
+    }
+
+    /**
+     * The number of recorded frames, including those which might not have been written yet.
+     */
+    [[nodiscard]] std::size_t nFrames() const {
+        return nRecorded;
+    }
+
+private:
+    struct Snapshot {
+        std::size_t step {};
+        std::vector<dtype> positions {};
+        std::vector<ParticleType> types {};
+    };
+
+    void run() {
+        while (true) {
+            {
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [this] { return backPending || stop; });
+                if (!backPending) {
+                    return;
+                }
+            }
+            std::exception_ptr exception {};
+            try {
+                encode(back);
+                if (chunk.size() >= chunkSize) {
+                    flush();
+                }
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            {
+                std::scoped_lock lock{mutex};
+                backPending = false;
+                error = exception;
+            }
+            if (exception) {
+                cv.notify_all();
+                return;
+            }
+            cv.notify_all();
+        }
+    }
+
+    template<typename T>
+    void append(const T *data, std::size_t n) {
+        const auto *bytes = reinterpret_cast<const char *>(data);
+        chunk.insert(end(chunk), bytes, bytes + n * sizeof(T));
+    }
+
+    void pad() {
+        chunk.resize(chunk.size() + padded(chunk.size()) - chunk.size(), 0);
+    }
+
+    void encode(const Snapshot &snapshot) {
+        if (encoder) {
+            encodeQuantized(snapshot);
+            return;
+        }
+        // counting sort by type, blank slots carry the invalid type nTypes and are dropped
+        std::array<std::uint64_t, nTypes + 1> counts {};
+        for (const auto &type : snapshot.types) {
+            ++counts[type];
+        }
+        std::array<std::uint64_t, nTypes + 1> offsets {};
+        std::exclusive_scan(begin(counts), end(counts), begin(offsets), static_cast<std::uint64_t>(0));
+        const auto nParticles = offsets[nTypes];
+
+        sortedPositions.resize(nParticles * DIM);
+        sortedTypes.resize(nParticles);
+        for (std::size_t i = 0; i < snapshot.types.size(); ++i) {
+            const auto type = snapshot.types[i];
+            if (type < nTypes) {
+                const auto target = offsets[type]++;
+                sortedTypes[target] = type;
+                std::copy_n(begin(snapshot.positions) + DIM * i, DIM, begin(sortedPositions) + DIM * target);
+            }
+        }
+
+        FrameHeader frameHeader {
+            .step = snapshot.step,
+            .nParticles = nParticles,
+            .payloadBytes = rawPayloadBytes<dtype, ParticleType>(nTypes, DIM, nParticles)
+        };
+        index.push_back({.offset = offset + chunk.size(), .step = snapshot.step, .nParticles = nParticles});
+
+        append(&frameHeader, 1);
+        append(counts.data(), nTypes);
+        append(sortedPositions.data(), sortedPositions.size());
+        pad();
+        append(sortedTypes.data(), sortedTypes.size());
+        pad();
+    }
+
+    void encodeQuantized(const Snapshot &snapshot) {
+        const auto nParticles = static_cast<std::uint64_t>(std::count_if(
+                begin(snapshot.types), end(snapshot.types), [](const auto type) { return type < nTypes; }));
+        const auto headerPosition = chunk.size();
+        index.push_back({.offset = offset + headerPosition, .step = snapshot.step, .nParticles = nParticles});
+
+        FrameHeader frameHeader {.step = snapshot.step, .nParticles = nParticles};
+        append(&frameHeader, 1);
+        frameHeader.payloadBytes = encoder->encode(std::span<const dtype>(snapshot.positions),
+                                                   std::span<const ParticleType>(snapshot.types), chunk);
+        std::memcpy(chunk.data() + headerPosition, &frameHeader, sizeof(FrameHeader));
+    }
+
+    void flush() {
+        file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        offset += chunk.size();
+        chunk.clear();
+        if (!file) {
+            throw std::runtime_error("Failed to write trajectory chunk.");
+        }
+    }
+
+    std::ofstream file;
+    FileHeader header {};
+    std::size_t chunkSize;
+    std::uint64_t offset {};
+    std::vector<char> chunk {};
+    std::vector<FrameIndexEntry> index {};
+    std::optional<QuantizedEncoder<dtype, ParticleType, DIM>> encoder {};
+
+    std::vector<dtype> sortedPositions {};
+    std::vector<ParticleType> sortedTypes {};
+
+    Snapshot front {};
+    Snapshot back {};
+    bool backPending {false};
+    bool stop {false};
+    std::exception_ptr error {};
+    std::size_t nRecorded {0};
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+};
+
+}
@@ -7,6 +7,8 @@
 #include <string_view>
 #include <algorithm>
 #include <type_traits>
+#include <limits>
+#include <cstdint>
 
 #include <ctiprd/ParticleTypes.h>
 
@@ -31,6 +33,21 @@ concept system = requires (T instance){
     { instance.types[0] } -> std::convertible_to<ParticleType<typename T::dtype>>;
 };
 
+/**
+ * The smallest unsigned integer type which is able to represent all values in [0, N].
+ */
+template<std::size_t N>
+using smallest_uint_t = std::conditional_t<N <= std::numeric_limits<std::uint8_t>::max(), std::uint8_t,
+                        std::conditional_t<N <= std::numeric_limits<std::uint16_t>::max(), std::uint16_t,
+                        std::conditional_t<N <= std::numeric_limits<std::uint32_t>::max(), std::uint32_t,
+                        std::uint64_t>>>;
+
+/**
+ * Compact type used to store particle type ids, large enough to also hold nTypes as an invalid type.
+ */
+template<typename System>
+using particle_type_t = smallest_uint_t<System::types.size()>;
+
 template<auto &types>
 static constexpr std::size_t particleTypeId(std::string_view name) {
     std::size_t typeIndex = 0;
@@ -49,6 +66,7 @@ struct SystemInfo {
     static constexpr std::size_t DIM = System::DIM;
     static constexpr std::array<dtype, DIM> boxSize = System::boxSize;
     static constexpr std::size_t nTypes = System::types.size();
+    using ParticleType = particle_type_t<System>;
 
     using ExternalPotentials = typename System::ExternalPotentials;
     using PairPotentials = typename System::PairPotentials;
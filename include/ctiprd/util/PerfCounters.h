@@ -0,0 +1,249 @@
+/**
+ * @file PerfCounters.h
+ * @brief Hardware performance counters per integration phase via perf_event_open, compiled in only with
+ * CTIPRD_PERF_COUNTERS defined on Linux.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(CTIPRD_PERF_COUNTERS) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ctiprd::util::perf {
+
+#if defined(CTIPRD_PERF_COUNTERS) && defined(__linux__)
+inline constexpr bool counting = true;
+#else
+inline constexpr bool counting = false;
+#endif
+
+/**
+ * Counted events, in the order in which they are reported.
+ */
+enum class Event : std::size_t {
+    cycles, instructions, cacheMisses, branchMisses
+};
+inline constexpr std::size_t nEvents = 4;
+inline constexpr std::array<const char *, nEvents> eventNames {
+        "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+using Values = std::array<std::uint64_t, nEvents>;
+
+/**
+ * Upper bound on the number of phases counts can be attributed to.
+ */
+inline constexpr std::size_t maxPhases = 16;
+
+/**
+ * A group of the counted events on the calling thread. Opening fails gracefully, e.g., in containers without
+ * perf_event access or with a restrictive perf_event_paranoid setting, in which case reads yield zeros.
+ */
+class CounterGroup {
+public:
+    CounterGroup() {
+#if defined(CTIPRD_PERF_COUNTERS) && defined(__linux__)
+        constexpr std::array<std::uint64_t, nEvents> configs {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+                PERF_COUNT_HW_BRANCH_MISSES
+        };
+        for (std::size_t i = 0; i < nEvents; ++i) {
+            perf_event_attr attr {};
+            attr.size = sizeof(perf_event_attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0));
+            if (fds[i] < 0) {
+                close();
+                return;
+            }
+        }
+        if (ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+            close();
+        }
+#endif
+    }
+
+    ~CounterGroup() {
+        close();
+    }
+
+    CounterGroup(const CounterGroup &) = delete;
+    CounterGroup &operator=(const CounterGroup &) = delete;
+
+    [[nodiscard]] bool valid() const {
+        return fds[0] >= 0;
+    }
+
+    /**
+     * Current counts since the group was opened.
+     */
+    [[nodiscard]] Values read() const {
+        Values out {};
+#if defined(CTIPRD_PERF_COUNTERS) && defined(__linux__)
+        if (valid()) {
+            struct {
+                std::uint64_t nr;
+                std::array<std::uint64_t, nEvents> values;
+            } buffer {};
+            if (::read(fds[0], &buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer))) {
+                out = buffer.values;
+            }
+        }
+#endif
+        return out;
+    }
+
+private:
+    void close() {
+#if defined(CTIPRD_PERF_COUNTERS) && defined(__linux__)
+        for (auto &fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            fd = -1;
+        }
+#endif
+    }
+
+    std::array<int, nEvents> fds {-1, -1, -1, -1};
+};
+
+/**
+ * Per-thread counter groups and per-phase totals. Threads open their group on first use, afterwards they only ever
+ * touch their own totals, which are summed when reporting.
+ */
+class Registry {
+public:
+    struct ThreadCounters {
+        CounterGroup group;
+        std::array<std::array<std::atomic<std::uint64_t>, nEvents>, maxPhases> totals {};
+    };
+
+    static Registry &instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    ThreadCounters &local() {
+        thread_local ThreadCounters *counters = [this] {
+            std::scoped_lock lock {mutex};
+            return threads.emplace_back(std::make_unique<ThreadCounters>()).get();
+        }();
+        return *counters;
+    }
+
+    /**
+     * The phase subsequent scopes without explicit phase are attributed to, maxPhases for none.
+     */
+    void enter(std::size_t phase) {
+        currentPhase.store(phase, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::size_t phase() const {
+        return currentPhase.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Whether any thread managed to open its counters.
+     */
+    [[nodiscard]] bool available() {
+        std::scoped_lock lock {mutex};
+        for (const auto &thread : threads) {
+            if (thread->group.valid()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] std::array<Values, maxPhases> totals() {
+        std::array<Values, maxPhases> out {};
+        std::scoped_lock lock {mutex};
+        for (const auto &thread : threads) {
+            for (std::size_t p = 0; p < maxPhases; ++p) {
+                for (std::size_t e = 0; e < nEvents; ++e) {
+                    out[p][e] += thread->totals[p][e].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        return out;
+    }
+
+    void reset() {
+        std::scoped_lock lock {mutex};
+        for (auto &thread : threads) {
+            for (auto &phase : thread->totals) {
+                for (auto &value : phase) {
+                    value.store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+private:
+    Registry() = default;
+
+    std::atomic<std::size_t> currentPhase {maxPhases};
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadCounters>> threads;
+};
+
+/**
+ * Adds the counts of the calling thread between construction and destruction to a phase.
+ */
+class Scope {
+public:
+    /**
+     * Attributes to the current phase of the registry, as done by the tasks of the pool.
+     */
+    Scope() : Scope(counting ? Registry::instance().phase() : maxPhases) {}
+
+    /**
+     * Attributes to the given phase, counts nothing for maxPhases.
+     */
+    explicit Scope(std::size_t phase) : phase(phase) {
+        if constexpr(counting) {
+            if (phase < maxPhases) {
+                counters = &Registry::instance().local();
+                begin = counters->group.read();
+            }
+        }
+    }
+
+    ~Scope() {
+        if constexpr(counting) {
+            if (counters) {
+                const auto end = counters->group.read();
+                for (std::size_t e = 0; e < nEvents; ++e) {
+                    counters->totals[phase][e].fetch_add(end[e] - begin[e], std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    std::size_t phase;
+    Registry::ThreadCounters *counters {nullptr};
+    Values begin {};
+};
+
+}
@@ -0,0 +1,199 @@
+/**
+ * @file Profiler.h
+ * @brief Per-phase timers and counters of an integration step, compiled in only with CTIPRD_PROFILING defined. With
+ * CTIPRD_TRACING defined, the phases are recorded as trace events as well, with CTIPRD_PERF_COUNTERS hardware counters
+ * are sampled per phase.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <ctiprd/util/PerfCounters.h>
+#include <ctiprd/util/Trace.h>
+
+namespace ctiprd::util {
+
+#ifdef CTIPRD_PROFILING
+inline constexpr bool profiling = true;
+#else
+inline constexpr bool profiling = false;
+#endif
+
+/**
+ * Phases of a step. The periodic wrap is fused into the diffusion sweep and observables evaluated per particle are
+ * fused into it as well, observables only accounts for their begin and end.
+ */
+enum class Phase : std::size_t {
+    forceNeighborList, forces, diffusion, reactionNeighborList, screening, shuffle, resolve, observables
+};
+inline constexpr std::size_t nPhases = 8;
+static_assert(nPhases <= perf::maxPhases);
+inline constexpr std::array<const char *, nPhases> phaseNames {
+        "force_neighbor_list", "forces", "diffusion", "reaction_neighbor_list", "screening", "shuffle", "resolve",
+        "observables"
+};
+
+/**
+ * Work counts: second order pairs found within the reaction radius, reaction events generated and events dropped
+ * because one of their educts already reacted.
+ */
+enum class Counter : std::size_t {
+    pairsScreened, eventsGenerated, conflictsDropped
+};
+inline constexpr std::size_t nCounters = 3;
+inline constexpr std::array<const char *, nCounters> counterNames {
+        "pairs_screened", "events_generated", "conflicts_dropped"
+};
+
+/**
+ * Accumulated results, indexed by Phase and Counter respectively. Hardware counts are indexed by Phase and then
+ * perf::Event, they are summed over all threads of the process and only available if the counters could be opened.
+ */
+struct Profile {
+    std::array<double, nPhases> seconds {};
+    std::array<std::uint64_t, nPhases> calls {};
+    std::array<std::uint64_t, nCounters> counts {};
+    std::array<perf::Values, nPhases> hardware {};
+    bool hardwareAvailable {false};
+
+    [[nodiscard]] double secondsIn(Phase phase) const {
+        return seconds[static_cast<std::size_t>(phase)];
+    }
+
+    [[nodiscard]] std::uint64_t callsOf(Phase phase) const {
+        return calls[static_cast<std::size_t>(phase)];
+    }
+
+    [[nodiscard]] std::uint64_t count(Counter counter) const {
+        return counts[static_cast<std::size_t>(counter)];
+    }
+
+    [[nodiscard]] std::uint64_t hardwareCount(Phase phase, perf::Event event) const {
+        return hardware[static_cast<std::size_t>(phase)][static_cast<std::size_t>(event)];
+    }
+};
+
+/**
+ * Phases are timed from the thread driving the step, around the parallel sections they span. Counters are
+ * incremented from the workers, which tally locally and add once per task, each counter lives in its own cache line.
+ * Without CTIPRD_PROFILING every member is a no-op, with CTIPRD_TRACING scopes also record trace events.
+ */
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Whether integrators should hand out a profiler to their components at all.
+     */
+    static constexpr bool enabled = profiling || trace::tracing || perf::counting;
+
+    /**
+     * Adds the time from construction to destruction to a phase, tolerates a null profiler.
+     */
+    class Scope {
+    public:
+        Scope(Profiler *profiler, Phase phase)
+                : profiler(profiler), phase(phase),
+                  counters(profiler ? static_cast<std::size_t>(phase) : perf::maxPhases) {
+            if constexpr(enabled) {
+                if (profiler) {
+                    if constexpr(perf::counting) {
+                        perf::Registry::instance().enter(static_cast<std::size_t>(phase));
+                    }
+                    start = Clock::now();
+                    if constexpr(trace::tracing) {
+                        auto &tracer = trace::Tracer::instance();
+                        tracer.enter(phaseNames[static_cast<std::size_t>(phase)]);
+                        traceBegin = tracer.now();
+                    }
+                }
+            }
+        }
+
+        ~Scope() {
+            if constexpr(enabled) {
+                if (profiler) {
+                    profiler->add(phase, Clock::now() - start);
+                    if constexpr(trace::tracing) {
+                        auto &tracer = trace::Tracer::instance();
+                        tracer.local().push({phaseNames[static_cast<std::size_t>(phase)], traceBegin, tracer.now()});
+                        tracer.enter(nullptr);
+                    }
+                    if constexpr(perf::counting) {
+                        perf::Registry::instance().enter(perf::maxPhases);
+                    }
+                }
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Profiler *profiler;
+        Phase phase;
+        Clock::time_point start {};
+        std::int64_t traceBegin {0};
+        // counts of the driving thread, the pool's tasks count their own
+        perf::Scope counters;
+    };
+
+    void add(Phase phase, Clock::duration duration) {
+        if constexpr(profiling) {
+            const auto ix = static_cast<std::size_t>(phase);
+            durations[ix] += duration;
+            ++calls[ix];
+        }
+    }
+
+    void count(Counter counter, std::uint64_t n) {
+        if constexpr(profiling) {
+            counters[static_cast<std::size_t>(counter)].value.fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] Profile profile() const {
+        Profile out {};
+        for (std::size_t i = 0; i < nPhases; ++i) {
+            out.seconds[i] = std::chrono::duration<double>(durations[i]).count();
+            out.calls[i] = calls[i];
+        }
+        for (std::size_t i = 0; i < nCounters; ++i) {
+            out.counts[i] = counters[i].value.load(std::memory_order_relaxed);
+        }
+        if constexpr(perf::counting) {
+            auto &registry = perf::Registry::instance();
+            const auto totals = registry.totals();
+            std::copy_n(totals.begin(), nPhases, out.hardware.begin());
+            out.hardwareAvailable = registry.available();
+        }
+        return out;
+    }
+
+    void reset() {
+        durations.fill({});
+        calls.fill(0);
+        for (auto &counter : counters) {
+            counter.value.store(0, std::memory_order_relaxed);
+        }
+        if constexpr(perf::counting) {
+            perf::Registry::instance().reset();
+        }
+    }
+
+private:
+    struct alignas(64) AtomicSlot {
+        std::atomic<std::uint64_t> value {0};
+    };
+
+    std::array<Clock::duration, nPhases> durations {};
+    std::array<std::uint64_t, nPhases> calls {};
+    std::array<AtomicSlot, nCounters> counters {};
+};
+
+}
@@ -0,0 +1,218 @@
+/**
+ * @file Trace.h
+ * @brief Timelines of the pool's tasks in Chrome trace event format, compiled in only with CTIPRD_TRACING defined.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace ctiprd::util::trace {
+
+#ifdef CTIPRD_TRACING
+inline constexpr bool tracing = true;
+#else
+inline constexpr bool tracing = false;
+#endif
+
+/**
+ * A complete event, either a phase on the thread driving the step or a task covering the item range [first, last).
+ */
+struct Event {
+    const char *name {nullptr};
+    std::int64_t begin {0};
+    std::int64_t end {0};
+    std::size_t first {0};
+    std::size_t last {0};
+    bool task {false};
+};
+
+/**
+ * Ring buffer of the most recent events of one thread. Only the owning thread writes, readers must wait for the
+ * traced work to finish.
+ */
+class ThreadBuffer {
+public:
+    ThreadBuffer(std::size_t id, std::size_t capacity) : id(id), events(capacity) {}
+
+    void push(const Event &event) {
+        const auto n = size.load(std::memory_order_relaxed);
+        events[n % events.size()] = event;
+        size.store(n + 1, std::memory_order_release);
+    }
+
+    template<typename F>
+    void forEach(F &&f) const {
+        const auto n = size.load(std::memory_order_acquire);
+        const auto first = n > events.size() ? n - events.size() : 0;
+        for (auto i = first; i < n; ++i) {
+            f(events[i % events.size()]);
+        }
+    }
+
+    void clear() {
+        size.store(0, std::memory_order_release);
+    }
+
+    const std::size_t id;
+
+private:
+    std::vector<Event> events;
+    std::atomic<std::size_t> size {0};
+};
+
+/**
+ * Process-wide collection of the per-thread buffers. Threads register their buffer on their first event, afterwards
+ * recording does not synchronize beyond reading the current phase.
+ */
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::size_t capacity = 1 << 16;
+
+    static Tracer &instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    ThreadBuffer &local() {
+        thread_local ThreadBuffer *buffer = [this] {
+            std::scoped_lock lock {mutex};
+            return buffers.emplace_back(std::make_unique<ThreadBuffer>(buffers.size(), capacity)).get();
+        }();
+        return *buffer;
+    }
+
+    [[nodiscard]] std::int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+    }
+
+    void enter(const char *phase) {
+        currentPhase.store(phase, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] const char *phase() const {
+        return currentPhase.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Serializes all buffered events as Chrome trace JSON, loadable by chrome://tracing and Perfetto. Timestamps are
+     * in microseconds since the tracer was created.
+     */
+    [[nodiscard]] std::string chromeJson() {
+        std::scoped_lock lock {mutex};
+        std::string out {"{\"displayTimeUnit\":\"ns\",\"traceEvents\":["};
+        bool first {true};
+        for (const auto &buffer : buffers) {
+            out += fmt::format("{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},"
+                               "\"args\":{{\"name\":\"thread {}\"}}}}", first ? "" : ",", buffer->id, buffer->id);
+            first = false;
+            buffer->forEach([&out, &buffer](const Event &event) {
+                out += fmt::format(",{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},"
+                                   "\"ts\":{:.3f},\"dur\":{:.3f}", event.name ? event.name : "unknown",
+                                   event.task ? "task" : "phase", buffer->id, static_cast<double>(event.begin) / 1e3,
+                                   static_cast<double>(event.end - event.begin) / 1e3);
+                if (event.task) {
+                    out += fmt::format(",\"args\":{{\"first\":{},\"last\":{}}}", event.first, event.last);
+                }
+                out += "}";
+            });
+        }
+        out += "]}";
+        return out;
+    }
+
+    void write(const std::string &path) {
+        std::ofstream file {path};
+        if (!file) {
+            throw std::runtime_error(fmt::format("Could not open {} for writing.", path));
+        }
+        file << chromeJson();
+    }
+
+    /**
+     * Drops all buffered events, must not be called while traced work is running.
+     */
+    void clear() {
+        std::scoped_lock lock {mutex};
+        for (auto &buffer : buffers) {
+            buffer->clear();
+        }
+    }
+
+private:
+    Tracer() = default;
+
+    Clock::time_point epoch {Clock::now()};
+    std::atomic<const char *> currentPhase {nullptr};
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+/**
+ * Records a phase on the calling thread, tasks started meanwhile are tagged with its name.
+ */
+class PhaseScope {
+public:
+    explicit PhaseScope(const char *name) : name(name) {
+        if constexpr(tracing) {
+            Tracer::instance().enter(name);
+            begin = Tracer::instance().now();
+        }
+    }
+
+    ~PhaseScope() {
+        if constexpr(tracing) {
+            auto &tracer = Tracer::instance();
+            tracer.local().push({name, begin, tracer.now(), 0, 0, false});
+            tracer.enter(nullptr);
+        }
+    }
+
+    PhaseScope(const PhaseScope &) = delete;
+    PhaseScope &operator=(const PhaseScope &) = delete;
+
+private:
+    const char *name;
+    std::int64_t begin {0};
+};
+
+/**
+ * Records a task covering the items [first, last) on the calling thread.
+ */
+class TaskScope {
+public:
+    TaskScope(std::size_t first, std::size_t last) : first(first), last(last) {
+        if constexpr(tracing) {
+            begin = Tracer::instance().now();
+        }
+    }
+
+    ~TaskScope() {
+        if constexpr(tracing) {
+            auto &tracer = Tracer::instance();
+            tracer.local().push({tracer.phase(), begin, tracer.now(), first, last, true});
+        }
+    }
+
+    TaskScope(const TaskScope &) = delete;
+    TaskScope &operator=(const TaskScope &) = delete;
+
+private:
+    std::size_t first;
+    std::size_t last;
+    std::int64_t begin {0};
+};
+
+}
@@ -1,8 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <thread>
 #include <random>
 #include <ctime>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <ostream>
+#include <vector>
 
 namespace ctiprd::rnd {
 
@@ -32,6 +43,112 @@ RealType uniform_real(const RealType a = 0.0, const RealType b = 1.0) {
     return distribution(staticThreadLocalGenerator<Generator>());
 }
 
+/**
+ * Buffer of standard normal variates which is refilled in bulk. The refill draws all uniforms first and then applies
+ * the Box-Muller transform over contiguous halves of the buffer without data-dependent branches, so that the
+ * compiler can vectorize it (given a vector math library); otherwise it degrades gracefully to a tight scalar loop.
+ * Uniforms carry 24 random bits for float (one draw) and 52 for double (two draws), the smallest uniform is half a unit
+ * of that resolution. Variates are thus bounded in magnitude by about 5.9 for float and 8.6 for double.
+ *
+ * @tparam RealType the floating point type
+ * @tparam N number of variates generated per refill, must be even
+ */
+template<typename RealType, std::size_t N = 1024>
+class normal_buffer {
+    static_assert(N > 0 && N % 2 == 0, "Box-Muller generates variates in pairs, buffer size must be even.");
+public:
+    using result_type = RealType;
+
+    template<typename Generator>
+    result_type operator()(Generator &generator) {
+        if (current == N) {
+            refill(generator);
+        }
+        return buffer[current++];
+    }
+
+    template<typename Generator>
+    void refill(Generator &generator) {
+        static_assert(Generator::max() - Generator::min() >= 0xffffffff, "Generator needs to yield 32 random bits.");
+        static constexpr std::size_t half = N / 2;
+        static constexpr auto twoPi = 2 * std::numbers::pi_v<RealType>;
+        const auto draw = [&generator]() { return static_cast<std::uint32_t>(generator() - Generator::min()); };
+
+        if constexpr(std::numeric_limits<RealType>::digits > 24) {
+            static constexpr auto scale = static_cast<RealType>(1. / (std::uint64_t {1} << 52U));
+            for (auto &u : buffer) {
+                // upper 26 bits of two draws mapped onto the open interval (0, 1), exact including the half offset
+                const auto high = static_cast<std::uint64_t>(draw() >> 6U);
+                const auto low = static_cast<std::uint64_t>(draw() >> 6U);
+                u = (static_cast<RealType>((high << 26U) | low) + static_cast<RealType>(.5)) * scale;
+            }
+        } else {
+            static constexpr auto scale = static_cast<RealType>(1. / (1U << 24U));
+            for (auto &u : buffer) {
+                // upper 24 bits mapped onto the open interval (0, 1)
+                const auto bits = draw() >> 8U;
+                u = (static_cast<RealType>(bits) + static_cast<RealType>(.5)) * scale;
+            }
+        }
+
+        auto* radii = buffer.data();
+        auto* angles = buffer.data() + half;
+        for (std::size_t i = 0; i < half; ++i) {
+            const auto r = std::sqrt(-2 * std::log(radii[i]));
+            const auto theta = twoPi * angles[i];
+            radii[i] = r * std::cos(theta);
+            angles[i] = r * std::sin(theta);
+        }
+        current = 0;
+    }
+
+    /**
+     * Writes the pending variates such that reading them back continues the exact same sequence.
+     */
+    friend std::ostream &operator<<(std::ostream &os, const normal_buffer &b) {
+        const auto flags = os.flags();
+        const auto precision = os.precision(std::numeric_limits<RealType>::max_digits10);
+        os << b.current;
+        for (auto it = b.buffer.begin() + b.current; it != b.buffer.end(); ++it) {
+            os << ' ' << *it;
+        }
+        os.precision(precision);
+        os.flags(flags);
+        return os;
+    }
+
+    friend std::istream &operator>>(std::istream &is, normal_buffer &b) {
+        std::size_t current {};
+        if (is >> current && current <= N) {
+            b.current = current;
+            for (auto it = b.buffer.begin() + b.current; it != b.buffer.end() && is; ++it) {
+                is >> *it;
+            }
+        } else {
+            is.setstate(std::ios::failbit);
+        }
+        return is;
+    }
+
+private:
+    std::array<result_type, N> buffer {};
+    std::size_t current {N};
+};
+
+template<typename RealType>
+normal_buffer<RealType> &staticThreadLocalNormalBuffer() {
+    static thread_local normal_buffer<RealType> buffer {};
+    return buffer;
+}
+
+/**
+ * Thread local normal_buffer, yields standard normal variates.
+ */
+template<typename RealType, typename Generator = std::mt19937>
+RealType normal() {
+    return staticThreadLocalNormalBuffer<RealType>()(staticThreadLocalGenerator<Generator>());
+}
+
 template<typename RealType>
 class dirichlet_distribution {
 public:
@@ -8,14 +8,68 @@
  */
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstddef>
+
 namespace ctiprd::util::pbc {
 
+namespace detail {
+template<typename System>
+inline constexpr auto inverseBoxSize = [] {
+    std::array<typename System::dtype, System::DIM> result {};
+    for (std::size_t d = 0; d < System::DIM; ++d) {
+        result[d] = static_cast<typename System::dtype>(1) / System::boxSize[d];
+    }
+    return result;
+}();
+}
+
+/**
+ * Wraps a position (or difference vector) into the origin-centered box [-L/2, L/2) in a branch-free manner,
+ * yielding the minimum image when applied to differences.
+ *
+ * @tparam System the system, determines periodicity and box size
+ * @tparam Position the position type
+ * @param pos the position, modified in place
+ */
 template<typename System, typename Position>
 void wrapPBC(Position &pos) {
     if constexpr(System::periodic) {
-        for (int d = 0; d < System::DIM; ++d) {
-            while (pos[d] >= .5 * System::boxSize[d]) pos[d] -= System::boxSize[d];
-            while (pos[d] < -.5 * System::boxSize[d]) pos[d] += System::boxSize[d];
+        using dtype = typename System::dtype;
+        for (std::size_t d = 0; d < System::DIM; ++d) {
+            const auto boxSize = System::boxSize[d];
+            pos[d] -= boxSize * std::floor(pos[d] * detail::inverseBoxSize<System>[d] + static_cast<dtype>(.5));
+            // guard against rounding onto the upper (open) boundary, compiles to selects instead of branches
+            pos[d] -= static_cast<dtype>(pos[d] >= static_cast<dtype>(.5) * boxSize) * boxSize;
+            pos[d] += static_cast<dtype>(pos[d] < static_cast<dtype>(-.5) * boxSize) * boxSize;
+        }
+    }
+}
+
+/**
+ * Wraps a position like wrapPBC(pos) and adds the number of box lengths it was shifted by to the image counters, so
+ * that pos + image * boxSize keeps tracking the unwrapped position.
+ *
+ * @tparam System the system, determines periodicity and box size
+ * @tparam Position the position type
+ * @tparam Image the image counter type, an array of integers
+ * @param pos the position, modified in place
+ * @param image the image counters, modified in place
+ */
+template<typename System, typename Position, typename Image>
+void wrapPBC(Position &pos, Image &image) {
+    if constexpr(System::periodic) {
+        using dtype = typename System::dtype;
+        for (std::size_t d = 0; d < System::DIM; ++d) {
+            const auto boxSize = System::boxSize[d];
+            const auto shift = std::floor(pos[d] * detail::inverseBoxSize<System>[d] + static_cast<dtype>(.5));
+            pos[d] -= boxSize * shift;
+            const auto above = static_cast<dtype>(pos[d] >= static_cast<dtype>(.5) * boxSize);
+            pos[d] -= above * boxSize;
+            const auto below = static_cast<dtype>(pos[d] < static_cast<dtype>(-.5) * boxSize);
+            pos[d] += below * boxSize;
+            image[d] += static_cast<typename Image::value_type>(shift + above - below);
         }
     }
 }
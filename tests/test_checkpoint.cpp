@@ -0,0 +1,164 @@
+/**
+ * @file test_checkpoint.cpp
+ * @brief Tests for checkpointing and restarting simulations.
+ */
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+
+#include <catch2/catch.hpp>
+
+#include <ctiprd/systems/lotka_volterra.h>
+#include <ctiprd/cpu/integrators/EulerMaruyama.h>
+#include <ctiprd/io/Checkpoint.h>
+#include <ctiprd/cpu/observables/basic.h>
+
+namespace {
+template<typename Particles>
+auto snapshot(const Particles &particles) {
+    std::vector<std::tuple<bool, typename Particles::ParticleType, std::vector<float>>> out;
+    for (std::size_t i = 0; i < particles.size(); ++i) {
+        std::vector<float> pos;
+        if (particles.exists(i)) {
+            pos.assign(begin(particles.positionOf(i).data), end(particles.positionOf(i).data));
+        }
+        out.emplace_back(particles.exists(i), particles.typeOf(i), pos);
+    }
+    return out;
+}
+}
+
+TEMPLATE_TEST_CASE_SIG("Checkpoint round trip", "[io][checkpoint]", ((int nThreads), nThreads), 1, 4) {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    System system {};
+    const auto path = std::filesystem::temp_directory_path() / fmt::format("ctiprd_test_checkpoint_{}.bin", nThreads);
+
+    auto pool = ctiprd::config::make_pool(nThreads);
+    auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+    integrator.particles()->initializeParticles(500, "prey");
+    integrator.particles()->initializeParticles(200, "predator");
+    integrator.particles()->removeParticle(11);
+    integrator.particles()->removeParticle(3);
+    for (int i = 0; i < 20; ++i) {
+        integrator.step(1e-2);
+    }
+
+    ctiprd::io::saveCheckpoint(path, integrator, pool);
+    const auto saved = snapshot(*integrator.particles());
+    const auto savedBlanks = integrator.particles()->blankSlots();
+    const auto savedForces = integrator.particles()->forces();
+
+    for (int i = 0; i < 20; ++i) {
+        integrator.step(1e-2);
+    }
+    const auto continued = snapshot(*integrator.particles());
+
+    auto restoredPool = ctiprd::config::make_pool(nThreads);
+    auto restored = ctiprd::cpu::integrator::EulerMaruyama{system, restoredPool};
+    ctiprd::io::loadCheckpoint(path, restored, restoredPool);
+
+    REQUIRE(restored.nSteps() == 20);
+    REQUIRE(snapshot(*restored.particles()) == saved);
+    REQUIRE(restored.particles()->blankSlots() == savedBlanks);
+    REQUIRE(restored.particles()->forces().size() == savedForces.size());
+    for (std::size_t i = 0; i < savedForces.size(); ++i) {
+        REQUIRE(restored.particles()->forces()[i].data == savedForces[i].data);
+    }
+
+    if (nThreads == 1) {
+        // with a single worker the continued run is reproduced bit by bit
+        for (int i = 0; i < 20; ++i) {
+            restored.step(1e-2);
+        }
+        REQUIRE(restored.nSteps() == 40);
+        REQUIRE(snapshot(*restored.particles()) == continued);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Checkpoint continues 3D fissions exactly", "[io][checkpoint]") {
+    // 3D fissions draw an odd number of normal variates, any buffered variate has to survive the restart
+    using System = ctiprd::systems::LotkaVolterra3D<float>;
+    using Integrator = ctiprd::cpu::integrator::EulerMaruyama<System>;
+    using Particles = Integrator::Particles;
+    System system {};
+    const auto path = std::filesystem::temp_directory_path() / "ctiprd_test_checkpoint_3d.bin";
+
+    auto pool = ctiprd::config::make_pool(1);
+    Integrator integrator {system, pool};
+    integrator.particles()->initializeParticles(500, "prey");
+    integrator.particles()->initializeParticles(50, "predator");
+    for (int i = 0; i < 5; ++i) {
+        integrator.step(1e-2);
+    }
+
+    ctiprd::io::saveCheckpoint(path, integrator, pool);
+    auto events = integrator.observables().add<ctiprd::cpu::observables::ReactionCounts<Particles>>(20, 1);
+    for (int i = 0; i < 20; ++i) {
+        integrator.step(1e-2);
+    }
+    const auto continued = snapshot(*integrator.particles());
+    // prey births happened after the checkpoint
+    REQUIRE(events->series().frame(0)[0] > 0);
+
+    auto restoredPool = ctiprd::config::make_pool(1);
+    Integrator restored {system, restoredPool};
+    ctiprd::io::loadCheckpoint(path, restored, restoredPool);
+    for (int i = 0; i < 20; ++i) {
+        restored.step(1e-2);
+    }
+    REQUIRE(snapshot(*restored.particles()) == continued);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Checkpoint rejects foreign systems", "[io][checkpoint]") {
+    const auto path = std::filesystem::temp_directory_path() / "ctiprd_test_checkpoint_foreign.bin";
+    auto pool = ctiprd::config::make_pool(2);
+    {
+        ctiprd::systems::LotkaVolterra<float> system {};
+        auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+        integrator.particles()->initializeParticles(10, "prey");
+        ctiprd::io::saveCheckpoint(path, integrator, pool);
+    }
+    ctiprd::systems::LotkaVolterra<double> system {};
+    auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+    REQUIRE_THROWS(ctiprd::io::loadCheckpoint(path, integrator, pool));
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Checkpoint rejects malformed files", "[io][checkpoint]") {
+    const auto path = std::filesystem::temp_directory_path() / "ctiprd_test_checkpoint_malformed.bin";
+    const auto corrupted = std::filesystem::temp_directory_path() / "ctiprd_test_checkpoint_corrupted.bin";
+    ctiprd::systems::LotkaVolterra<float> system {};
+    auto pool = ctiprd::config::make_pool(2);
+    auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+    integrator.particles()->initializeParticles(10, "prey");
+    integrator.particles()->removeParticle(4);
+    ctiprd::io::saveCheckpoint(path, integrator, pool);
+
+    ctiprd::io::CheckpointHeader header {};
+    {
+        std::ifstream file (path, std::ios::binary);
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    }
+    const auto rejected = [&](std::uint64_t position, auto value) {
+        std::filesystem::copy_file(path, corrupted, std::filesystem::copy_options::overwrite_existing);
+        {
+            std::fstream file (corrupted, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(static_cast<std::streamoff>(position));
+            file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+        auto restored = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+        REQUIRE_THROWS_AS(ctiprd::io::loadCheckpoint(corrupted, restored, pool), std::runtime_error);
+    };
+    rejected(offsetof(ctiprd::io::CheckpointHeader, version), std::uint32_t {2});
+    // length of the first generator state reaching past the generator states
+    const auto rngBegin = sizeof(header) + header.nBlanks * sizeof(std::uint64_t) + header.stateBytes;
+    rejected(rngBegin, header.rngBytes);
+    // more threads than generator states fit
+    rejected(offsetof(ctiprd::io::CheckpointHeader, nThreads), header.rngBytes);
+
+    std::filesystem::remove(corrupted);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,50 @@
+/**
+ * @file test_distribution_utils.cpp
+ * @brief Tests for the random number utilities.
+ */
+
+#include <cmath>
+#include <numbers>
+
+#include <catch2/catch.hpp>
+
+#include <ctiprd/util/distribution_utils.h>
+
+TEMPLATE_TEST_CASE("Normal buffer moments", "[random]", float, double) {
+    auto generator = ctiprd::rnd::seededGenerator(42);
+    ctiprd::rnd::normal_buffer<TestType, 128> buffer {};
+
+    const std::size_t n = 200000;
+    double mean {0};
+    double secondMoment {0};
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto x = static_cast<double>(buffer(generator));
+        REQUIRE(std::isfinite(x));
+        mean += x;
+        secondMoment += x * x;
+    }
+    mean /= n;
+    secondMoment /= n;
+
+    REQUIRE(mean == Approx(0.).margin(1e-2));
+    REQUIRE(secondMoment == Approx(1.).margin(1e-2));
+}
+
+namespace {
+// yields the smallest possible output, i.e., the smallest uniform the buffer can build
+struct MinimalGenerator {
+    using result_type = std::uint32_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xffffffff; }
+    result_type operator()() { return 0; }
+};
+}
+
+TEMPLATE_TEST_CASE("Normal buffer tails", "[random]", float, double) {
+    MinimalGenerator generator {};
+    ctiprd::rnd::normal_buffer<TestType, 2> buffer {};
+    // the radius of the smallest uniform, at an angle close to zero
+    const auto x = static_cast<double>(buffer(generator));
+    const auto bits = std::is_same_v<TestType, float> ? 24. : 52.;
+    REQUIRE(x == Approx(std::sqrt(2 * (bits + 1) * std::numbers::ln2)).epsilon(1e-5));
+}
@@ -1,10 +1,15 @@
 //
 // Created by mho on 4/22/22.
 //
+#include <set>
+
 #include <catch2/catch.hpp>
+#include <ctiprd/cpu/MultiResolutionNeighborList.h>
 #include <ctiprd/cpu/NeighborList.h>
 #include <ctiprd/cpu/ParticleCollection.h>
+#include <ctiprd/cpu/SubdivisionTuner.h>
 #include <ctiprd/systems/double_well.h>
+#include <ctiprd/systems/lotka_volterra.h>
 
 TEST_CASE("Cell adjacency full", "[nl]") {
     using Index = ctiprd::util::Index<2, std::array<std::int32_t, 2>>;
@@ -68,3 +73,261 @@ TEST_CASE("Test NeighborList for two particles", "[nl]") {
         spdlog::error("1 got neighbor {}", nId);
     });
 }
+
+TEMPLATE_TEST_CASE_SIG("Pair screening matches brute force", "[nl]", ((bool gathered), gathered), false, true) {
+    using System = ctiprd::systems::DoubleWell<float>;
+    using CollectionType = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions, ctiprd::cpu::particles::forces>;
+    auto pool = ctiprd::config::make_pool(4);
+
+    const float cutoff = .4;
+    ctiprd::cpu::nl::NeighborList<2, System::periodic, float, true> nl {System::boxSize, cutoff};
+    CollectionType collection{};
+    collection.initializeParticles(500, "A");
+    nl.update(&collection, pool);
+
+    std::set<std::tuple<std::size_t, std::size_t>> pairs;
+    const auto collect = [&pairs, cutoff](auto id1, auto id2, auto distSquared) {
+        REQUIRE(distSquared <= cutoff * cutoff);
+        auto inserted = pairs.emplace(std::min(id1, id2), std::max(id1, id2)).second;
+        REQUIRE(inserted);
+    };
+    for (std::size_t cell = 0; cell < nl.nCellsTotal(); ++cell) {
+        nl.forEachPairInRange<gathered>(collection, cell, cutoff * cutoff, collect);
+    }
+
+    std::set<std::tuple<std::size_t, std::size_t>> reference;
+    for (std::size_t i = 0; i < collection.size(); ++i) {
+        for (std::size_t j = i + 1; j < collection.size(); ++j) {
+            if (ctiprd::util::pbc::dSquared<System>(collection.positionOf(i), collection.positionOf(j)) <= cutoff * cutoff) {
+                reference.emplace(i, j);
+            }
+        }
+    }
+    REQUIRE(pairs == reference);
+}
+
+TEST_CASE("Changing the subdivision keeps the pairs in range", "[nl]") {
+    using System = ctiprd::systems::DoubleWell<float>;
+    using CollectionType = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions, ctiprd::cpu::particles::forces>;
+    auto pool = ctiprd::config::make_pool(4);
+
+    const float cutoff = .4;
+    ctiprd::cpu::nl::NeighborList<2, System::periodic, float, true> nl {System::boxSize, cutoff, 1};
+    CollectionType collection{};
+    collection.initializeParticles(500, "A");
+
+    const auto pairsInRange = [&]() {
+        nl.update(&collection, pool);
+        std::set<std::tuple<std::size_t, std::size_t>> pairs;
+        for (std::size_t cell = 0; cell < nl.nCellsTotal(); ++cell) {
+            nl.forEachPairInRange(collection, cell, cutoff * cutoff, [&pairs](auto id1, auto id2, auto) {
+                pairs.emplace(std::min(id1, id2), std::max(id1, id2));
+            });
+        }
+        return pairs;
+    };
+
+    const auto reference = pairsInRange();
+    const auto nCellsCoarse = nl.nCellsTotal();
+    nl.setSubdivides(3);
+    REQUIRE(nl.nSubdivides() == 3);
+    REQUIRE(nl.nCellsTotal() > nCellsCoarse);
+    REQUIRE(pairsInRange() == reference);
+}
+
+namespace {
+struct TunedList {
+    int nSubdivides() const {
+        return subdivides;
+    }
+
+    void setSubdivides(int n) {
+        subdivides = n;
+        ++nRebuilds;
+    }
+
+    std::size_t adjacencyEntries(int n) const {
+        return static_cast<std::size_t>(n);
+    }
+
+    int subdivides {2};
+    int nRebuilds {0};
+};
+}
+
+TEST_CASE("Subdivision tuner", "[nl]") {
+    ctiprd::cpu::nl::SubdivisionTuner tuner {{.candidates = {1, 2, 3, 4}, .samples = 2, .retuneFactor = 2.,
+                                              .maxAdjacencyEntries = 3}};
+    TunedList list {};
+
+    tuner.begin(list, 100);
+    tuner.end(list);
+    REQUIRE(list.nRebuilds == 0);
+    REQUIRE_FALSE(tuner.tuning());
+
+    tuner.enable();
+    std::set<int> sampled;
+    for (int step = 0; step < 6; ++step) {
+        tuner.begin(list, 100);
+        REQUIRE(tuner.tuning());
+        sampled.insert(list.nSubdivides());
+        tuner.end(list);
+    }
+    // the fourth candidate exceeds the table size
+    REQUIRE(sampled == std::set<int>{1, 2, 3});
+    REQUIRE_FALSE(tuner.tuning());
+    REQUIRE(sampled.contains(list.nSubdivides()));
+
+    SECTION("Stays with its choice for similar densities") {
+        tuner.begin(list, 150);
+        REQUIRE_FALSE(tuner.tuning());
+        tuner.begin(list, 60);
+        REQUIRE_FALSE(tuner.tuning());
+    }
+    SECTION("Retunes once the density changed") {
+        tuner.begin(list, 201);
+        REQUIRE(tuner.tuning());
+        REQUIRE(list.nSubdivides() == 1);
+    }
+}
+
+namespace {
+template<typename System, bool periodic>
+void checkGrids(float cutoff, int nSubdivides, std::size_t n) {
+    using CollectionType = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions, ctiprd::cpu::particles::forces>;
+    using NeighborList = ctiprd::cpu::nl::NeighborList<System::DIM, periodic, float, true>;
+    auto pool = ctiprd::config::make_pool(4);
+
+    CollectionType collection{};
+    collection.initializeParticles(n, "prey");
+
+    std::set<std::tuple<std::size_t, std::size_t>> reference;
+    for (std::size_t i = 0; i < collection.size(); ++i) {
+        for (std::size_t j = i + 1; j < collection.size(); ++j) {
+            float distSquared {0};
+            for (std::size_t d = 0; d < System::DIM; ++d) {
+                auto dx = collection.positionOf(j)[d] - collection.positionOf(i)[d];
+                if constexpr(periodic) {
+                    dx -= System::boxSize[d] * std::round(dx / System::boxSize[d]);
+                }
+                distSquared += dx * dx;
+            }
+            if (distSquared <= cutoff * cutoff) {
+                reference.emplace(i, j);
+            }
+        }
+    }
+
+    using ctiprd::cpu::nl::CellGrid;
+    using ctiprd::cpu::nl::Adjacency;
+    for (const auto &[grid, adjacency] : {std::make_tuple(CellGrid::dense, Adjacency::table),
+                                          std::make_tuple(CellGrid::dense, Adjacency::stencil),
+                                          std::make_tuple(CellGrid::sparse, Adjacency::automatic)}) {
+        NeighborList nl {System::boxSize, cutoff, nSubdivides, grid};
+        nl.setAdjacency(adjacency);
+        nl.update(&collection, pool);
+        REQUIRE(nl.sparse() == (grid == CellGrid::sparse));
+        if (!nl.sparse()) {
+            REQUIRE(nl.adjacencyTable() == (adjacency == Adjacency::table));
+        }
+
+        std::set<std::tuple<std::size_t, std::size_t>> pairs;
+        for (std::size_t cell = 0; cell < nl.nCellsTotal(); ++cell) {
+            nl.forEachPairInRange(collection, cell, cutoff * cutoff, [&pairs](auto id1, auto id2, auto) {
+                REQUIRE(pairs.emplace(std::min(id1, id2), std::max(id1, id2)).second);
+            });
+        }
+        REQUIRE(pairs == reference);
+
+        std::set<std::tuple<std::size_t, std::size_t>> neighbors;
+        for (std::size_t i = 0; i < collection.size(); ++i) {
+            nl.forEachNeighbor(i, collection, [&](auto j, const auto &, const auto &, const auto &) {
+                if (i < j && reference.contains({i, j})) {
+                    neighbors.emplace(i, j);
+                }
+            });
+        }
+        REQUIRE(neighbors == reference);
+    }
+}
+}
+
+TEST_CASE("Sparse grids and stencil adjacency find the same pairs as tables", "[nl]") {
+    using System2D = ctiprd::systems::LotkaVolterra<float>;
+    using System3D = ctiprd::systems::LotkaVolterra3D<float>;
+    SECTION("2D periodic") {
+        checkGrids<System2D, true>(.3f, 2, 1000);
+    }
+    SECTION("2D non-periodic") {
+        checkGrids<System2D, false>(.3f, 1, 1000);
+    }
+    SECTION("3D periodic") {
+        checkGrids<System3D, true>(.5f, 2, 1000);
+    }
+    SECTION("3D non-periodic") {
+        checkGrids<System3D, false>(.5f, 3, 1000);
+    }
+    SECTION("Stencil wider than the grid") {
+        checkGrids<System3D, true>(4.f, 2, 300);
+    }
+}
+
+TEST_CASE("Automatic grid follows the occupancy", "[nl]") {
+    using System = ctiprd::systems::LotkaVolterra3D<float>;
+    using CollectionType = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions, ctiprd::cpu::particles::forces>;
+    auto pool = ctiprd::config::make_pool(4);
+
+    // 100^3 cells
+    ctiprd::cpu::nl::NeighborList<3, true, float, true> nl {System::boxSize, .2f, 2};
+    CollectionType collection{};
+    collection.initializeParticles(1000, "prey");
+    nl.update(&collection, pool);
+    REQUIRE(nl.sparse());
+    REQUIRE(nl.nCellsTotal() <= 1000);
+
+    collection.initializeParticles(199000, "prey");
+    nl.update(&collection, pool);
+    REQUIRE_FALSE(nl.sparse());
+    REQUIRE(nl.nCellsTotal() == 1000000);
+}
+
+TEST_CASE("Automatic adjacency avoids large tables", "[nl]") {
+    using NeighborList = ctiprd::cpu::nl::NeighborList<3, true, float, true>;
+    // 40^3 cells with 27 adjacent cells each
+    NeighborList coarse {{10.f, 10.f, 10.f}, .25f, 1, ctiprd::cpu::nl::CellGrid::dense};
+    REQUIRE(coarse.adjacencyTable());
+    REQUIRE(coarse.adjacencyEntries(1) > 0);
+    // 160^3 cells with 729 adjacent cells each
+    NeighborList fine {{10.f, 10.f, 10.f}, .25f, 4, ctiprd::cpu::nl::CellGrid::dense};
+    REQUIRE_FALSE(fine.adjacencyTable());
+    REQUIRE(fine.adjacencyEntries(4) == 0);
+    REQUIRE(fine.nCellsTotal() == 160 * 160 * 160);
+}
+
+TEST_CASE("Type pairs are grouped into radius classes", "[nl]") {
+    using NeighborLists = ctiprd::cpu::nl::MultiResolutionNeighborList<2, true, float>;
+    const NeighborLists nls {{10.f, 10.f}, {{0, 0, .5f}, {0, 1, .6f}, {1, 1, .1f}, {2, 2, .04f}, {0, 0, 1.f},
+                                            {1, 2, 0.f}}};
+    REQUIRE(nls.size() == 3);
+    REQUIRE(nls.radius(0) == 1.f);
+    REQUIRE(nls.radius(1) == .1f);
+    REQUIRE(nls.radius(2) == .04f);
+
+    REQUIRE(nls.classOf(0, 0) == 0);
+    REQUIRE(nls.classOf(0, 1) == 0);
+    REQUIRE(nls.classOf(1, 0) == 0);
+    REQUIRE(nls.classOf(1, 1) == 1);
+    REQUIRE(nls.classOf(2, 2) == 2);
+    REQUIRE(nls.classOf(1, 2) == NeighborLists::none);
+    REQUIRE(nls.classOf(0, 7) == NeighborLists::none);
+
+    REQUIRE(nls.grid(0).isAllowedType(0));
+    REQUIRE(nls.grid(0).isAllowedType(1));
+    REQUIRE_FALSE(nls.grid(0).isAllowedType(2));
+    REQUIRE_FALSE(nls.grid(1).isAllowedType(0));
+    REQUIRE(nls.grid(2).isAllowedType(2));
+
+    const NeighborLists merged {{10.f, 10.f}, {{0, 0, .5f}, {0, 1, .6f}, {1, 1, .1f}}, 10.f};
+    REQUIRE(merged.size() == 1);
+    REQUIRE(merged.classOf(1, 1) == 0);
+}
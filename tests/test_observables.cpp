@@ -0,0 +1,412 @@
+/**
+ * @file test_observables.cpp
+ * @brief Tests for observables evaluated during integration.
+ */
+
+#include <complex>
+#include <numbers>
+
+#include <catch2/catch.hpp>
+
+#include <ctiprd/systems/lotka_volterra.h>
+#include <ctiprd/cpu/integrators/EulerMaruyama.h>
+#include <ctiprd/cpu/observables/basic.h>
+#include <ctiprd/cpu/observables/dynamics.h>
+#include <ctiprd/cpu/observables/structure.h>
+
+namespace {
+using System = ctiprd::systems::LotkaVolterra<float>;
+using Integrator = ctiprd::cpu::integrator::EulerMaruyama<System>;
+using Particles = Integrator::Particles;
+
+struct FreeDiffusion {
+    using dtype = float;
+    static constexpr std::size_t DIM = 2;
+    static constexpr std::array<dtype, DIM> boxSize {4., 4.};
+    static constexpr bool periodic = true;
+    static constexpr dtype kBT = 1.;
+    static constexpr ctiprd::ParticleTypes<dtype, 2> types {{
+            {.name = "A", .diffusionConstant = .5},
+            {.name = "B", .diffusionConstant = 2.},
+    }};
+
+    using ExternalPotentials = std::tuple<>;
+    using PairPotentials = std::tuple<>;
+    using ReactionsO1 = std::tuple<>;
+    using ReactionsO2 = std::tuple<>;
+
+    ExternalPotentials externalPotentials {};
+    PairPotentials pairPotentials {};
+    ReactionsO1 reactionsO1 {};
+    ReactionsO2 reactionsO2 {};
+};
+using DiffusionParticles = ctiprd::cpu::ParticleCollection<FreeDiffusion, ctiprd::cpu::particles::positions,
+                                                           ctiprd::cpu::particles::forces,
+                                                           ctiprd::cpu::particles::images>;
+using DiffusionIntegrator = ctiprd::cpu::integrator::EulerMaruyama<FreeDiffusion, ctiprd::config::ThreadPool,
+                                                                   std::mt19937, DiffusionParticles>;
+
+template<typename F>
+void forEachExisting(const Particles &particles, F &&f) {
+    for (std::size_t i = 0; i < particles.size(); ++i) {
+        if (particles.exists(i)) {
+            f(particles.positionOf(i), particles.typeOf(i));
+        }
+    }
+}
+}
+
+TEST_CASE("Observables record the configuration at the beginning of a step", "[observables]") {
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    Integrator integrator {system, pool};
+    integrator.particles()->initializeParticles(3000, "prey");
+    integrator.particles()->initializeParticles(1000, "predator");
+
+    auto counts = integrator.observables().add<ctiprd::cpu::observables::ParticleCounts<Particles>>(3, 10);
+    auto histogram = integrator.observables().add<ctiprd::cpu::observables::PositionHistogram<Particles>>(
+            3, 10, 1, 25);
+    auto energy = integrator.observables().add<ctiprd::cpu::observables::PotentialEnergy<Particles>>(3, 10);
+
+    std::vector<std::array<std::uint64_t, 2>> expectedCounts;
+    std::vector<std::vector<std::uint64_t>> expectedHistograms;
+    std::vector<double> expectedEnergies;
+    const ctiprd::cpu::forces::detail::CPUForceO1<Particles, std::tuple_element_t<0, System::ExternalPotentials>> box {
+            std::get<0>(system.externalPotentials)
+    };
+    for (std::size_t t = 0; t < 30; ++t) {
+        if (t % 3 == 0) {
+            std::array<std::uint64_t, 2> n {};
+            std::vector<std::uint64_t> hist (2 * 25, 0);
+            double e {0};
+            forEachExisting(*integrator.particles(), [&](const auto &pos, const auto &type) {
+                ++n[type];
+                ++hist[type * 25 + static_cast<std::size_t>(std::floor((pos[1] + 25.f) / 2.f))];
+                e += box.energy(pos);
+            });
+            expectedCounts.push_back(n);
+            expectedHistograms.push_back(hist);
+            expectedEnergies.push_back(e);
+        }
+        integrator.step(1e-2);
+    }
+
+    REQUIRE(counts->series().size() == 10);
+    REQUIRE(histogram->series().frameShape() == std::vector<std::size_t>{2, 25});
+    for (std::size_t k = 0; k < 10; ++k) {
+        REQUIRE(counts->series().steps()[k] == 3 * k);
+        const auto frame = counts->series().frame(k);
+        REQUIRE(std::vector(begin(frame), end(frame)) == std::vector(begin(expectedCounts[k]), end(expectedCounts[k])));
+        const auto histFrame = histogram->series().frame(k);
+        REQUIRE(std::vector(begin(histFrame), end(histFrame)) == expectedHistograms[k]);
+        REQUIRE(energy->series().frame(k)[0] == Approx(expectedEnergies[k]).epsilon(1e-4));
+    }
+
+    // the series is preallocated and does not grow
+    REQUIRE_THROWS_AS(integrator.step(1e-2), std::length_error);
+}
+
+TEST_CASE("Reaction counts balance particle counts", "[observables]") {
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    Integrator integrator {system, pool};
+    integrator.particles()->initializeParticles(3000, "prey");
+    integrator.particles()->initializeParticles(1000, "predator");
+
+    auto counts = integrator.observables().add<ctiprd::cpu::observables::ParticleCounts<Particles>>(5, 11);
+    auto events = integrator.observables().add<ctiprd::cpu::observables::ReactionCounts<Particles>>(5, 10);
+    for (std::size_t t = 0; t <= 50; ++t) {
+        integrator.step(1e-2);
+    }
+
+    REQUIRE(events->series().size() == 10);
+    std::uint64_t nEvents {0};
+    for (std::size_t k = 0; k < 10; ++k) {
+        REQUIRE(events->series().steps()[k] == counts->series().steps()[k + 1]);
+        const auto before = counts->series().frame(k);
+        const auto after = counts->series().frame(k + 1);
+        const auto e = events->series().frame(k);
+        const auto [birth, death, preyFriction, predatorFriction, eat] = std::tuple{e[0], e[1], e[2], e[3], e[4]};
+        REQUIRE(after[System::preyId] + preyFriction + eat == before[System::preyId] + birth);
+        REQUIRE(after[System::predatorId] + death + predatorFriction == before[System::predatorId] + eat);
+        nEvents += std::accumulate(begin(e), end(e), std::uint64_t {0});
+    }
+    REQUIRE(nEvents > 0);
+}
+
+TEST_CASE("Density grid counts particles per cell", "[observables]") {
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    Integrator integrator {system, pool};
+    integrator.particles()->initializeParticles(3000, "prey");
+    integrator.particles()->initializeParticles(1000, "predator");
+
+    auto grid = integrator.observables().add<ctiprd::cpu::observables::DensityGrid<Particles>>(
+            2, 5, std::array<std::size_t, 2> {5, 10});
+    REQUIRE(grid->series().frameShape() == std::vector<std::size_t>{2, 5, 10});
+    REQUIRE(grid->cellCenters(0) == std::vector<float>{-4.f, -2.f, 0.f, 2.f, 4.f});
+
+    std::vector<std::vector<std::uint32_t>> expected;
+    for (std::size_t t = 0; t < 10; ++t) {
+        if (t % 2 == 0) {
+            std::vector<std::uint32_t> cells (2 * 5 * 10, 0);
+            forEachExisting(*integrator.particles(), [&](const auto &pos, const auto &type) {
+                const auto i = static_cast<std::size_t>(std::floor((pos[0] + 5.f) / 2.f));
+                const auto j = static_cast<std::size_t>(std::floor((pos[1] + 25.f) / 5.f));
+                ++cells[(type * 5 + i) * 10 + j];
+            });
+            expected.push_back(cells);
+        }
+        integrator.step(1e-2);
+    }
+
+    REQUIRE(grid->series().size() == 5);
+    for (std::size_t k = 0; k < 5; ++k) {
+        REQUIRE(grid->series().steps()[k] == 2 * k);
+        const auto frame = grid->series().frame(k);
+        REQUIRE(std::vector(begin(frame), end(frame)) == expected[k]);
+    }
+}
+
+TEST_CASE("Radial distribution and structure factor match brute force", "[observables]") {
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    Integrator integrator {system, pool};
+    integrator.particles()->initializeParticles(400, "prey");
+    integrator.particles()->initializeParticles(300, "predator");
+    integrator.particles()->removeParticle(17);
+
+    constexpr std::size_t nBins = 20;
+    constexpr float rMax = 4.f;
+    constexpr float kMax = 3.f;
+    auto rdf = integrator.observables().add<ctiprd::cpu::observables::RadialDistribution<Particles>>(
+            1, 1, rMax, nBins);
+    auto sk = integrator.observables().add<ctiprd::cpu::observables::StructureFactor<Particles>>(1, 1, kMax, nBins);
+
+    std::vector<std::tuple<System::dtype, System::dtype, std::size_t>> particles;
+    forEachExisting(*integrator.particles(), [&](const auto &pos, const auto &type) {
+        particles.emplace_back(pos[0], pos[1], type);
+    });
+    integrator.step(1e-2);
+
+    std::array<std::size_t, 2> n {};
+    for (const auto &[x, y, type] : particles) {
+        ++n[type];
+    }
+
+    std::vector<double> pairs (2 * 2 * nBins, 0);
+    for (std::size_t i = 0; i < particles.size(); ++i) {
+        for (std::size_t j = i + 1; j < particles.size(); ++j) {
+            const auto &[x1, y1, t1] = particles[i];
+            const auto &[x2, y2, t2] = particles[j];
+            std::array<float, 2> diff {x2 - x1, y2 - y1};
+            float dSquared {0};
+            for (std::size_t d = 0; d < 2; ++d) {
+                diff[d] -= System::boxSize[d] * std::floor(diff[d] / System::boxSize[d] + .5f);
+                dSquared += diff[d] * diff[d];
+            }
+            const auto bin = static_cast<std::size_t>(std::sqrt(dSquared) * (nBins / rMax));
+            if (dSquared <= rMax * rMax && bin < nBins) {
+                ++pairs[(t1 * 2 + t2) * nBins + bin];
+                ++pairs[(t2 * 2 + t1) * nBins + bin];
+            }
+        }
+    }
+    const auto volume = System::boxSize[0] * System::boxSize[1];
+    REQUIRE(rdf->radii().front() == Approx(rMax / nBins / 2));
+    for (std::size_t a = 0; a < 2; ++a) {
+        for (std::size_t b = 0; b < 2; ++b) {
+            const double nPairs = static_cast<double>(n[a]) * static_cast<double>(a == b ? n[b] - 1 : n[b]);
+            for (std::size_t bin = 0; bin < nBins; ++bin) {
+                const double r0 = rMax / nBins * bin;
+                const double r1 = rMax / nBins * (bin + 1);
+                const double shell = std::numbers::pi * (r1 * r1 - r0 * r0);
+                const double expected = pairs[(a * 2 + b) * nBins + bin] * volume / (nPairs * shell);
+                REQUIRE(rdf->series().frame(0)[(a * 2 + b) * nBins + bin] == Approx(expected).epsilon(1e-4));
+            }
+        }
+    }
+
+    // brute force structure factor over the same wave vectors
+    std::vector<double> expected (2 * 2 * nBins, 0);
+    std::vector<std::size_t> shellSizes (nBins, 0);
+    const auto nx = static_cast<int>(kMax * System::boxSize[0] / (2 * std::numbers::pi));
+    const auto ny = static_cast<int>(kMax * System::boxSize[1] / (2 * std::numbers::pi));
+    for (int i = -nx; i <= nx; ++i) {
+        for (int j = -ny; j <= ny; ++j) {
+            if (i < 0 || (i == 0 && j <= 0)) {
+                continue;
+            }
+            const double kx = 2 * std::numbers::pi * i / System::boxSize[0];
+            const double ky = 2 * std::numbers::pi * j / System::boxSize[1];
+            const auto k = std::sqrt(kx * kx + ky * ky);
+            if (k > kMax) {
+                continue;
+            }
+            const auto shell = std::min(static_cast<std::size_t>(k / kMax * nBins), nBins - 1);
+            ++shellSizes[shell];
+            std::array<std::complex<double>, 2> rho {};
+            for (const auto &[x, y, type] : particles) {
+                rho[type] += std::exp(std::complex<double>(0, -(kx * x + ky * y)));
+            }
+            for (std::size_t a = 0; a < 2; ++a) {
+                for (std::size_t b = 0; b < 2; ++b) {
+                    expected[(a * 2 + b) * nBins + shell] += std::real(rho[a] * std::conj(rho[b]))
+                                                             / std::sqrt(static_cast<double>(n[a] * n[b]));
+                }
+            }
+        }
+    }
+    for (std::size_t ix = 0; ix < expected.size(); ++ix) {
+        const auto shell = ix % nBins;
+        const auto value = shellSizes[shell] > 0 ? expected[ix] / shellSizes[shell] : 0.;
+        REQUIRE(sk->series().frame(0)[ix] == Approx(value).margin(1e-2));
+    }
+}
+
+TEST_CASE("Structure observables reject degenerate bins", "[observables]") {
+    using ctiprd::cpu::observables::RadialDistribution;
+    using ctiprd::cpu::observables::StructureFactor;
+    REQUIRE_THROWS_AS(RadialDistribution<Particles>(1, 1, 1.f, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(RadialDistribution<Particles>(1, 1, 0.f, 10), std::invalid_argument);
+    REQUIRE_THROWS_AS(RadialDistribution<Particles>(1, 1, -1.f, 10), std::invalid_argument);
+    REQUIRE_THROWS_AS(StructureFactor<Particles>(1, 1, 5.f, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(StructureFactor<Particles>(1, 1, 0.f, 10), std::invalid_argument);
+}
+
+TEST_CASE("Multi-tau mean-squared displacement matches brute force", "[observables]") {
+    FreeDiffusion system {};
+    auto pool = ctiprd::config::make_pool(4);
+    DiffusionIntegrator integrator {system, pool};
+    integrator.particles()->initializeParticles(50, "A");
+    integrator.particles()->initializeParticles(50, "B");
+
+    constexpr std::size_t nSamples = 200;
+    auto msd = integrator.observables().add<ctiprd::cpu::observables::MeanSquaredDisplacement<DiffusionParticles>>(
+            2, 1, nSamples, 100, 4);
+    const auto lags = msd->lags();
+    REQUIRE(lags == std::vector<std::uint64_t>{2, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192});
+
+    // unwrapped positions per sample
+    std::vector<std::vector<std::array<double, 2>>> trajectory;
+    for (std::size_t t = 0; t < 2 * nSamples; ++t) {
+        if (t % 2 == 0) {
+            const auto &particles = *integrator.particles();
+            auto &frame = trajectory.emplace_back();
+            for (std::size_t i = 0; i < particles.size(); ++i) {
+                frame.push_back({particles.positionOf(i)[0] + particles.imageOf(i)[0] * FreeDiffusion::boxSize[0],
+                                 particles.positionOf(i)[1] + particles.imageOf(i)[1] * FreeDiffusion::boxSize[1]});
+            }
+        }
+        integrator.step(1e-2);
+    }
+    REQUIRE(msd->series().size() == 1);
+
+    // unwrapped trajectories are continuous across the boundaries
+    std::size_t nCrossings {0};
+    double maxJump {0};
+    for (std::size_t n = 1; n < nSamples; ++n) {
+        for (std::size_t i = 0; i < trajectory[n].size(); ++i) {
+            for (std::size_t d = 0; d < 2; ++d) {
+                maxJump = std::max(maxJump, std::abs(trajectory[n][i][d] - trajectory[n - 1][i][d]));
+                const auto box = FreeDiffusion::boxSize[d];
+                nCrossings += std::floor(trajectory[n][i][d] / box + .5) != std::floor(trajectory[n - 1][i][d] / box + .5);
+            }
+        }
+    }
+    REQUIRE(nCrossings > 0);
+    REQUIRE(maxJump < 2.);
+
+    const auto frame = msd->series().frame(0);
+    for (std::size_t l = 0; l < lags.size(); ++l) {
+        const auto lag = lags[l] / 2;
+        // samples at the level of this lag
+        std::size_t spacing = 1;
+        while (lag >= 4 * spacing) {
+            spacing *= 2;
+        }
+        std::array<double, 2> sums {};
+        std::array<std::size_t, 2> counts {};
+        for (std::size_t n = lag; n < nSamples; n += spacing) {
+            if (n % spacing != 0) {
+                continue;
+            }
+            for (std::size_t i = 0; i < trajectory[n].size(); ++i) {
+                const auto type = integrator.particles()->typeOf(i);
+                const auto dx = trajectory[n][i][0] - trajectory[n - lag][i][0];
+                const auto dy = trajectory[n][i][1] - trajectory[n - lag][i][1];
+                sums[type] += dx * dx + dy * dy;
+                ++counts[type];
+            }
+        }
+        for (std::size_t type = 0; type < 2; ++type) {
+            REQUIRE(frame[type * lags.size() + l] == Approx(sums[type] / counts[type]).epsilon(1e-3));
+        }
+    }
+}
+
+TEST_CASE("Mean-squared displacement restarts reused slots", "[observables]") {
+    FreeDiffusion system {};
+    auto pool = ctiprd::config::make_pool(2);
+    DiffusionIntegrator integrator {system, pool};
+    auto &particles = *integrator.particles();
+    particles.initializeParticles(2, "A");
+
+    const auto unwrapped = [&particles](std::size_t i) {
+        return std::array<double, 2> {particles.positionOf(i)[0] + particles.imageOf(i)[0] * FreeDiffusion::boxSize[0],
+                                      particles.positionOf(i)[1] + particles.imageOf(i)[1] * FreeDiffusion::boxSize[1]};
+    };
+
+    auto msd = integrator.observables().add<ctiprd::cpu::observables::MeanSquaredDisplacement<DiffusionParticles>>(
+            2, 1, 2, 2, 2);
+    REQUIRE(msd->lags() == std::vector<std::uint64_t>{2});
+    const auto before = unwrapped(1);
+    integrator.step(1e-2);
+    integrator.step(1e-2);
+
+    // between the two samples, a particle of the same type takes over slot 0 far away from its previous occupant
+    const auto previous = particles.positionOf(0);
+    const auto generation = particles.generationOf(0);
+    particles.removeParticle(0);
+    particles.addParticle({previous[0] > 0 ? previous[0] - 1.5f : previous[0] + 1.5f,
+                           previous[1] > 0 ? previous[1] - 1.5f : previous[1] + 1.5f}, "A");
+    REQUIRE(particles.exists(0));
+    REQUIRE(particles.generationOf(0) != generation);
+
+    const auto after = unwrapped(1);
+    integrator.step(1e-2);
+    integrator.step(1e-2);
+
+    // only slot 1 contributes to the first lag
+    REQUIRE(msd->series().size() == 1);
+    const auto dx = after[0] - before[0];
+    const auto dy = after[1] - before[1];
+    REQUIRE(msd->series().frame(0)[0] == Approx(dx * dx + dy * dy).epsilon(1e-4));
+}
+
+TEST_CASE("Mean-squared displacement recovers diffusion constants", "[observables]") {
+    FreeDiffusion system {};
+    auto pool = ctiprd::config::make_pool(4);
+    DiffusionIntegrator integrator {system, pool};
+    integrator.particles()->initializeParticles(1000, "A");
+    integrator.particles()->initializeParticles(1000, "B");
+
+    auto msd = integrator.observables().add<ctiprd::cpu::observables::MeanSquaredDisplacement<DiffusionParticles>>(
+            1, 2, 250, 100);
+    for (std::size_t t = 0; t < 500; ++t) {
+        integrator.step(1e-2);
+    }
+
+    REQUIRE(msd->series().size() == 2);
+    const auto lags = msd->lags();
+    const auto frame = msd->series().frame(1);
+    for (std::size_t type = 0; type < 2; ++type) {
+        for (std::size_t l = 0; l < lags.size(); ++l) {
+            if (lags[l] <= 100) {
+                const auto expected = 2 * FreeDiffusion::DIM * FreeDiffusion::types[type].diffusionConstant
+                                      * 1e-2 * static_cast<double>(lags[l]);
+                REQUIRE(frame[type * lags.size() + l] == Approx(expected).epsilon(.05));
+            }
+        }
+    }
+}
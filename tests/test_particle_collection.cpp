@@ -155,3 +155,51 @@ TEST_CASE("Test against michaelis menten", "[particles][michaelis-menten]") {
     REQUIRE(nES.load() == 0);
     REQUIRE(nP.load() == 0);
 }
+
+TEST_CASE("Bulk insertion matches single insertion", "[particles]") {
+    using System = ctiprd::systems::DoubleWell<float>;
+    using Collection = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions, ctiprd::cpu::particles::forces>;
+    auto pool = ctiprd::config::make_pool(3);
+
+    std::vector<Collection::Position> positions;
+    std::vector<std::size_t> types;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        positions.push_back({{static_cast<float>(i) / 1000.f, -static_cast<float>(i) / 1000.f}});
+        types.push_back(i % System::types.size());
+    }
+
+    Collection single {};
+    Collection bulk {};
+    for (auto *collection : {&single, &bulk}) {
+        for (std::size_t i = 0; i < 10; ++i) {
+            collection->addParticle({{1.f, 1.f}}, 0);
+        }
+        collection->setForce(3, {{1.f, 2.f}});
+        for (std::size_t i : {7, 3, 5}) {
+            collection->removeParticle(i);
+        }
+    }
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        single.addParticle(positions[i], types[i]);
+    }
+    bulk.addParticles(std::span<const Collection::Position>{positions}, std::span<const std::size_t>{types}, pool);
+
+    REQUIRE(bulk.size() == single.size());
+    REQUIRE(bulk.nParticles() == 1007);
+    REQUIRE(bulk.blankSlots().empty());
+    REQUIRE(bulk.positions() == single.positions());
+    REQUIRE(bulk.types() == single.types());
+    REQUIRE(bulk.forces() == single.forces());
+
+    const std::array<std::size_t, 1> one {0};
+    bulk.addParticles(std::span<const Collection::Position>{positions}.first(5), std::span<const std::size_t>{one});
+    REQUIRE(bulk.nParticles() == 1012);
+    REQUIRE(bulk.typeOf(1011) == 0);
+
+    const std::array<std::size_t, 2> wrongCount {0, 0};
+    REQUIRE_THROWS_AS(bulk.addParticles(std::span<const Collection::Position>{positions},
+                                        std::span<const std::size_t>{wrongCount}), std::invalid_argument);
+    const std::array<std::size_t, 1> wrongType {System::types.size()};
+    REQUIRE_THROWS_AS(bulk.addParticles(std::span<const Collection::Position>{positions},
+                                        std::span<const std::size_t>{wrongType}), std::invalid_argument);
+}
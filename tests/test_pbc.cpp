@@ -0,0 +1,62 @@
+/**
+ * @file test_pbc.cpp
+ * @brief Tests for periodic wrapping and minimum image differences.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <ctiprd/vec.h>
+#include <ctiprd/util/pbc.h>
+#include <ctiprd/systems/lotka_volterra.h>
+
+TEST_CASE("Periodic wrap", "[pbc]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    using Vec = ctiprd::Vec<float, 2>;
+
+    for (float x : {-31.f, -15.f, -5.f, -4.99f, 0.f, 4.99f, 5.f, 12.5f, 1e3f}) {
+        Vec pos {{x, 5 * x}};
+        ctiprd::util::pbc::wrapPBC<System>(pos);
+        for (std::size_t d = 0; d < System::DIM; ++d) {
+            REQUIRE(pos[d] >= -.5f * System::boxSize[d]);
+            REQUIRE(pos[d] < .5f * System::boxSize[d]);
+        }
+        REQUIRE(std::remainder(pos[0] - x, System::boxSize[0]) == Approx(0.f).margin(1e-3));
+        REQUIRE(std::remainder(pos[1] - 5 * x, System::boxSize[1]) == Approx(0.f).margin(1e-2));
+    }
+
+    {
+        Vec pos {{5.f, -25.f}};
+        ctiprd::util::pbc::wrapPBC<System>(pos);
+        REQUIRE(pos[0] == -5.f);
+        REQUIRE(pos[1] == -25.f);
+    }
+}
+
+TEST_CASE("Periodic wrap with image counters", "[pbc]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    using Vec = ctiprd::Vec<float, 2>;
+
+    for (float x : {-31.f, -15.f, -5.f, 0.f, 4.99f, 5.f, 12.5f, 1e3f}) {
+        Vec pos {{x, 5 * x}};
+        std::array<std::int32_t, 2> image {1, -2};
+        ctiprd::util::pbc::wrapPBC<System>(pos, image);
+        for (std::size_t d = 0; d < System::DIM; ++d) {
+            REQUIRE(pos[d] >= -.5f * System::boxSize[d]);
+            REQUIRE(pos[d] < .5f * System::boxSize[d]);
+        }
+        REQUIRE(pos[0] + static_cast<float>(image[0] - 1) * System::boxSize[0] == Approx(x).margin(1e-3));
+        REQUIRE(pos[1] + static_cast<float>(image[1] + 2) * System::boxSize[1] == Approx(5 * x).margin(1e-2));
+    }
+}
+
+TEST_CASE("Minimum image", "[pbc]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    using Vec = ctiprd::Vec<float, 2>;
+
+    Vec p1 {{-4.9f, 24.f}};
+    Vec p2 {{4.9f, -24.f}};
+    auto diff = ctiprd::util::pbc::shortestDifference<System>(p1, p2);
+    REQUIRE(diff[0] == Approx(-.2f));
+    REQUIRE(diff[1] == Approx(2.f));
+    REQUIRE(ctiprd::util::pbc::dSquared<System>(p1, p2) == Approx(.04f + 4.f));
+}
@@ -0,0 +1,69 @@
+#include <numeric>
+
+#include <catch2/catch.hpp>
+
+#include <ctiprd/systems/lotka_volterra.h>
+#include <ctiprd/cpu/integrators/EulerMaruyama.h>
+#include <ctiprd/cpu/observables/basic.h>
+#include <ctiprd/util/Profiler.h>
+
+TEST_CASE("Step profiler accounts for every phase", "[profiler]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    using Phase = ctiprd::util::Phase;
+    using Counter = ctiprd::util::Counter;
+
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    ctiprd::cpu::integrator::EulerMaruyama integrator {system, pool};
+    integrator.particles()->initializeParticles(2000, "prey");
+    integrator.particles()->initializeParticles(2000, "predator");
+
+    constexpr std::uint64_t nSteps = 10;
+    using Particles = decltype(integrator)::Particles;
+    auto reactionCounts = integrator.observables().add<ctiprd::cpu::observables::ReactionCounts<Particles>>(
+            nSteps, 1);
+    for (std::uint64_t t = 0; t < nSteps; ++t) {
+        integrator.step(1e-2);
+    }
+
+    const auto profile = integrator.profile();
+    if constexpr(ctiprd::util::profiling) {
+        for (auto phase : {Phase::forces, Phase::diffusion, Phase::reactionNeighborList, Phase::screening,
+                           Phase::shuffle, Phase::resolve}) {
+            REQUIRE(profile.callsOf(phase) == nSteps);
+        }
+        // no pair potentials, hence no force neighbor list
+        REQUIRE(profile.callsOf(Phase::forceNeighborList) == 0);
+        REQUIRE(profile.secondsIn(Phase::diffusion) > 0.);
+        REQUIRE(profile.count(Counter::pairsScreened) > 0);
+        REQUIRE(profile.count(Counter::eventsGenerated) > 0);
+        // every generated event is either performed or dropped
+        const auto frame = reactionCounts->series().frame(0);
+        const auto nPerformed = std::accumulate(frame.begin(), frame.end(), std::uint64_t {0});
+        REQUIRE(nPerformed + profile.count(Counter::conflictsDropped) == profile.count(Counter::eventsGenerated));
+
+        integrator.resetProfile();
+        REQUIRE(integrator.profile().callsOf(Phase::diffusion) == 0);
+        REQUIRE(integrator.profile().count(Counter::eventsGenerated) == 0);
+    } else {
+        for (std::size_t i = 0; i < ctiprd::util::nPhases; ++i) {
+            REQUIRE(profile.calls[i] == 0);
+            REQUIRE(profile.seconds[i] == 0.);
+        }
+        for (std::size_t i = 0; i < ctiprd::util::nCounters; ++i) {
+            REQUIRE(profile.counts[i] == 0);
+        }
+    }
+
+    if constexpr(ctiprd::util::perf::counting) {
+        // containers commonly deny perf_event_open, which must leave the counts empty instead of failing
+        const auto cycles = profile.hardwareCount(Phase::diffusion, ctiprd::util::perf::Event::cycles);
+        if (profile.hardwareAvailable) {
+            REQUIRE(cycles > 0);
+        } else {
+            REQUIRE(cycles == 0);
+        }
+    } else {
+        REQUIRE_FALSE(profile.hardwareAvailable);
+    }
+}
@@ -2,12 +2,121 @@
 // Created by mho on 3/28/22.
 //
 
+#include <random>
+#include <set>
+
 #include <catch2/catch.hpp>
 #include <ctiprd/cpu/UncontrolledApproximation.h>
 #include <ctiprd/systems/double_well.h>
+#include <ctiprd/util/pbc.h>
 
 TEST_CASE("UncontrolledApproximation sanity", "[reactions]") {
     using System = ctiprd::systems::DoubleWell<float>;
     using ParticleCollection = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions>;
     ctiprd::cpu::UncontrolledApproximation<ParticleCollection, System> ua {System{}};
 }
+
+TEST_CASE("Compact reaction events", "[reactions]") {
+    using System = ctiprd::systems::DoubleWell<float>;
+    using ParticleCollection = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions>;
+    using UA = ctiprd::cpu::UncontrolledApproximation<ParticleCollection, System>;
+    STATIC_REQUIRE(std::is_same_v<ParticleCollection::ParticleType, std::uint8_t>);
+    STATIC_REQUIRE(std::is_same_v<UA::ReactionIndex, std::uint8_t>);
+    STATIC_REQUIRE(sizeof(UA::Event) == 3 * sizeof(std::size_t));
+}
+
+namespace {
+
+template<typename T>
+struct TwoRadiiSystem {
+    using dtype = T;
+    static constexpr std::size_t DIM = 2;
+    static constexpr std::array<T, DIM> boxSize {5., 5.};
+    static constexpr bool periodic = true;
+    static constexpr T kBT = 1.;
+    static constexpr ctiprd::ParticleTypes<dtype, 3> types {{
+            {.name = "A", .diffusionConstant = 1.},
+            {.name = "B", .diffusionConstant = 1.},
+            {.name = "C", .diffusionConstant = 1.},
+    }};
+    static constexpr auto aId = ctiprd::systems::particleTypeId<types>("A");
+    static constexpr auto bId = ctiprd::systems::particleTypeId<types>("B");
+    static constexpr auto cId = ctiprd::systems::particleTypeId<types>("C");
+
+    TwoRadiiSystem() {
+        auto &[longRange, shortRange] = reactionsO2;
+        longRange.catalyst = aId;
+        longRange.eductType = aId;
+        longRange.productType = aId;
+        longRange.rate = 1e6;
+        longRange.reactionRadius = 1.;
+
+        shortRange.catalyst = bId;
+        shortRange.eductType = cId;
+        shortRange.productType = cId;
+        shortRange.rate = 1e6;
+        shortRange.reactionRadius = .1;
+    }
+
+    using ExternalPotentials = std::tuple<>;
+    using PairPotentials = std::tuple<>;
+    using ReactionsO1 = std::tuple<>;
+    using ReactionsO2 = std::tuple<ctiprd::reactions::doi::Catalysis<T>, ctiprd::reactions::doi::Catalysis<T>>;
+
+    ReactionsO1 reactionsO1 {};
+    ReactionsO2 reactionsO2 {};
+    ExternalPotentials externalPotentials {};
+    PairPotentials pairPotentials {};
+};
+
+}
+
+TEST_CASE("Reactions are screened per radius class", "[reactions]") {
+    using System = TwoRadiiSystem<float>;
+    using ParticleCollection = ctiprd::cpu::ParticleCollection<System, ctiprd::cpu::particles::positions,
+                                                               ctiprd::cpu::particles::forces>;
+    auto pool = ctiprd::config::make_pool(4);
+
+    ctiprd::cpu::UncontrolledApproximation<ParticleCollection, System> ua {System{}};
+    REQUIRE(ua.neighborLists_.size() == 2);
+    REQUIRE(ua.neighborLists_.radius(0) == 1.f);
+    REQUIRE(ua.neighborLists_.radius(1) == .1f);
+
+    std::mt19937 generator {7};
+    std::uniform_real_distribution<float> coordinate {-2.5f, 2.5f};
+    std::uniform_int_distribution<std::size_t> type {0, 2};
+    std::vector<ParticleCollection::Position> positions (600);
+    std::vector<std::size_t> types (positions.size());
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        positions[i] = {{coordinate(generator), coordinate(generator)}};
+        types[i] = type(generator);
+    }
+    auto particles = std::make_shared<ParticleCollection>();
+    particles->addParticles(std::span<const ParticleCollection::Position>{positions},
+                            std::span<const std::size_t>{types});
+
+    // rates are high enough for every pair in range to react
+    ua.updateProbabilities(1.f);
+    ua.neighborLists_.update(particles.get(), pool);
+    const auto events = ua.screen(particles, pool);
+
+    std::set<std::tuple<std::size_t, std::size_t>> screened;
+    for (const auto &event : events) {
+        REQUIRE(event.nEducts == 2);
+        REQUIRE(screened.emplace(std::min(event.id1, event.id2), std::max(event.id1, event.id2)).second);
+    }
+
+    std::set<std::tuple<std::size_t, std::size_t>> reference;
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        for (std::size_t j = i + 1; j < positions.size(); ++j) {
+            const auto dSquared = ctiprd::util::pbc::dSquared<System>(positions[i], positions[j]);
+            const auto ab = std::minmax(types[i], types[j]);
+            if ((ab == std::minmax(System::aId, System::aId) && dSquared <= 1.f) ||
+                (ab == std::minmax(System::bId, System::cId) && dSquared <= .1f * .1f)) {
+                reference.emplace(i, j);
+            }
+        }
+    }
+    REQUIRE(!reference.empty());
+    REQUIRE(screened == reference);
+}
@@ -89,23 +89,48 @@ TEST_CASE("Test reactions map", "[reactions]") {
     System system {};
     {
         auto[map, backing] = ctiprd::cpu::reactions::impl::generateMapO1<Updater>(system);
+        for (auto &reaction : backing) {
+            reaction->updateProbability(1e50);
+        }
         REQUIRE(map[System::aId].size() == 2);
-        REQUIRE(map[System::aId][0]->shouldPerform(1e50));
-        REQUIRE(map[System::aId][1]->shouldPerform(1e50));
+        REQUIRE(map[System::aId][0]->shouldPerform());
+        REQUIRE(map[System::aId][1]->shouldPerform());
 
         REQUIRE(map[System::bId].size() == 2);
-        REQUIRE(map[System::bId][0]->shouldPerform(1e50));
-        REQUIRE(map[System::bId][1]->shouldPerform(1e50));
+        REQUIRE(map[System::bId][0]->shouldPerform());
+        REQUIRE(map[System::bId][1]->shouldPerform());
     }
     {
         auto [map, backing] = ctiprd::cpu::reactions::impl::generateMapO2<Updater>(system);
+        for (auto &reaction : backing) {
+            reaction->updateProbability(1e50);
+        }
         REQUIRE(map[std::make_tuple(System::aId, System::aId)].size() == 1);
-        REQUIRE(map[std::make_tuple(System::aId, System::aId)][0]->shouldPerform(1e50));
+        REQUIRE(map[std::make_tuple(System::aId, System::aId)][0]->shouldPerform());
 
         REQUIRE(map[std::make_tuple(System::aId, System::bId)].size() == 1);
         REQUIRE(map[std::make_tuple(System::bId, System::aId)].size() == 1);
         REQUIRE(map[std::make_tuple(System::bId, System::aId)] == map[std::make_tuple(System::aId, System::bId)]);
-        REQUIRE(map[std::make_tuple(System::aId, System::bId)][0]->shouldPerform(1e50));
-        REQUIRE(map[std::make_tuple(System::aId, System::bId)][0]->shouldPerform(1e50));
+        REQUIRE(map[std::make_tuple(System::aId, System::bId)][0]->shouldPerform());
+        REQUIRE(map[std::make_tuple(System::aId, System::bId)][0]->shouldPerform());
+    }
+}
+
+TEST_CASE("Reaction acceptance threshold", "[reactions]") {
+    using Generator = ctiprd::cpu::reactions::impl::detail::Generator;
+    using ctiprd::cpu::reactions::impl::detail::acceptanceThreshold;
+
+    REQUIRE(acceptanceThreshold(0.f, 1.f) == 0);
+    REQUIRE(acceptanceThreshold(1.f, 0.f) == 0);
+    REQUIRE(acceptanceThreshold(1.f, 1e30f) == static_cast<std::uint64_t>(Generator::max() - Generator::min()) + 1);
+
+    {
+        const auto threshold = acceptanceThreshold(2.f, .1f);
+        std::size_t nAccepted {0};
+        const std::size_t nDraws {100000};
+        for (std::size_t i = 0; i < nDraws; ++i) {
+            nAccepted += ctiprd::cpu::reactions::impl::detail::shouldPerform(threshold);
+        }
+        REQUIRE(static_cast<double>(nAccepted) / nDraws == Approx(1 - std::exp(-.2)).margin(1e-2));
     }
 }
@@ -0,0 +1,60 @@
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+#include <ctiprd/systems/lotka_volterra.h>
+#include <ctiprd/cpu/integrators/EulerMaruyama.h>
+#include <ctiprd/util/Trace.h>
+
+TEST_CASE("Trace buffers serialize to Chrome trace JSON", "[trace]") {
+    auto &tracer = ctiprd::util::trace::Tracer::instance();
+    tracer.clear();
+
+    tracer.local().push({"diffusion", 1000, 5000});
+    std::thread worker([&tracer] {
+        tracer.local().push({"diffusion", 2000, 3500, 10, 20, true});
+    });
+    worker.join();
+
+    const auto json = tracer.chromeJson();
+    REQUIRE(json.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    REQUIRE(json.ends_with("]}"));
+    REQUIRE(json.find("\"name\":\"diffusion\",\"cat\":\"phase\",\"ph\":\"X\"") != std::string::npos);
+    REQUIRE(json.find("\"ts\":1.000,\"dur\":4.000") != std::string::npos);
+    REQUIRE(json.find("\"cat\":\"task\"") != std::string::npos);
+    REQUIRE(json.find("\"ts\":2.000,\"dur\":1.500,\"args\":{\"first\":10,\"last\":20}") != std::string::npos);
+
+    tracer.clear();
+    REQUIRE(tracer.chromeJson().find("\"ph\":\"X\"") == std::string::npos);
+}
+
+TEST_CASE("Ring buffer keeps the most recent events", "[trace]") {
+    ctiprd::util::trace::ThreadBuffer buffer {0, 4};
+    for (std::int64_t i = 0; i < 10; ++i) {
+        buffer.push({"task", i, i + 1, 0, 0, true});
+    }
+    std::vector<std::int64_t> begins;
+    buffer.forEach([&begins](const auto &event) { begins.push_back(event.begin); });
+    REQUIRE(begins == std::vector<std::int64_t>{6, 7, 8, 9});
+}
+
+TEST_CASE("Integration steps record their tasks when tracing", "[trace]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    auto &tracer = ctiprd::util::trace::Tracer::instance();
+    tracer.clear();
+
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    ctiprd::cpu::integrator::EulerMaruyama integrator {system, pool};
+    integrator.particles()->initializeParticles(1000, "prey");
+    integrator.step(1e-2);
+
+    const auto json = tracer.chromeJson();
+    if constexpr(ctiprd::util::trace::tracing) {
+        REQUIRE(json.find("\"name\":\"diffusion\",\"cat\":\"task\"") != std::string::npos);
+        REQUIRE(json.find("\"name\":\"screening\",\"cat\":\"task\"") != std::string::npos);
+        REQUIRE(json.find("\"name\":\"diffusion\",\"cat\":\"phase\"") != std::string::npos);
+    } else {
+        REQUIRE(json.find("\"ph\":\"X\"") == std::string::npos);
+    }
+}
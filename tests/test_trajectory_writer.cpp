@@ -0,0 +1,279 @@
+/**
+ * @file test_trajectory_writer.cpp
+ * @brief Tests for the streaming trajectory writer.
+ */
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+
+#include <catch2/catch.hpp>
+
+#include <ctiprd/systems/lotka_volterra.h>
+#include <ctiprd/cpu/integrators/EulerMaruyama.h>
+#include <ctiprd/io/TrajectoryReader.h>
+#include <ctiprd/io/TrajectoryWriter.h>
+
+TEST_CASE("Trajectory writer", "[io]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    using ParticleType = ctiprd::systems::particle_type_t<System>;
+
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+    integrator.particles()->initializeParticles(100, "prey");
+    integrator.particles()->initializeParticles(50, "predator");
+    integrator.particles()->removeParticle(3);
+
+    const auto path = std::filesystem::temp_directory_path() / "ctiprd_test_trajectory_writer.bin";
+    const std::size_t nFrames = 5;
+    {
+        // small chunk size so that flushing happens in between frames
+        ctiprd::io::TrajectoryWriter<System> writer {path, 1024};
+        for (std::size_t step = 0; step < nFrames; ++step) {
+            writer.record(10 * step, integrator, pool);
+        }
+        REQUIRE(writer.nFrames() == nFrames);
+    }
+
+    std::ifstream file (path, std::ios::binary);
+    ctiprd::io::FileHeader header {};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    REQUIRE(header.valid());
+    REQUIRE(header.dim == 2);
+    REQUIRE(header.dtypeSize == sizeof(float));
+    REQUIRE(header.typeSize == sizeof(ParticleType));
+    REQUIRE(header.nFrames == nFrames);
+    REQUIRE(header.indexOffset > 0);
+
+    std::vector<ctiprd::io::FrameIndexEntry> index (nFrames);
+    file.seekg(static_cast<std::streamoff>(header.indexOffset));
+    file.read(reinterpret_cast<char *>(index.data()), nFrames * sizeof(ctiprd::io::FrameIndexEntry));
+
+    for (std::size_t k = 0; k < nFrames; ++k) {
+        REQUIRE(index[k].step == 10 * k);
+        REQUIRE(index[k].nParticles == 149);
+
+        file.seekg(static_cast<std::streamoff>(index[k].offset));
+        ctiprd::io::FrameHeader frameHeader {};
+        file.read(reinterpret_cast<char *>(&frameHeader), sizeof(frameHeader));
+        REQUIRE(frameHeader.step == index[k].step);
+        REQUIRE(frameHeader.nParticles == 149);
+
+        std::array<std::uint64_t, 2> counts {};
+        file.read(reinterpret_cast<char *>(counts.data()), sizeof(counts));
+        REQUIRE(counts[System::predatorId] == 50);
+        REQUIRE(counts[System::preyId] == 99);
+
+        std::vector<float> positions (149 * 2);
+        file.read(reinterpret_cast<char *>(positions.data()), positions.size() * sizeof(float));
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            REQUIRE(std::abs(positions[i]) <= .5f * System::boxSize[i % 2]);
+        }
+        file.seekg(static_cast<std::streamoff>(ctiprd::io::padded(positions.size() * sizeof(float))
+                                               - positions.size() * sizeof(float)), std::ios::cur);
+        std::vector<ParticleType> types (149);
+        file.read(reinterpret_cast<char *>(types.data()), types.size() * sizeof(ParticleType));
+        REQUIRE(std::is_sorted(begin(types), end(types)));
+        REQUIRE(std::count(begin(types), end(types), System::preyId) == 99);
+    }
+    file.close();
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Trajectory reader", "[io]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    using ParticleType = ctiprd::systems::particle_type_t<System>;
+
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+    integrator.particles()->initializeParticles(30, "prey");
+    integrator.particles()->initializeParticles(20, "predator");
+
+    const auto path = std::filesystem::temp_directory_path() / "ctiprd_test_trajectory_reader.bin";
+    std::vector<std::vector<float>> expected;
+    {
+        ctiprd::io::TrajectoryWriter<System> writer {path, 512};
+        for (std::size_t step = 0; step < 10; ++step) {
+            writer.record(5 * step, integrator, pool);
+            // remember the positions grouped by type in the order they were written
+            std::vector<float> positions;
+            for (std::size_t type = 0; type < System::types.size(); ++type) {
+                for (std::size_t i = 0; i < integrator.particles()->size(); ++i) {
+                    if (integrator.particles()->exists(i) && integrator.particles()->typeOf(i) == type) {
+                        const auto &pos = integrator.particles()->positionOf(i);
+                        positions.insert(end(positions), begin(pos.data), end(pos.data));
+                    }
+                }
+            }
+            expected.push_back(positions);
+            integrator.step(1e-3);
+        }
+    }
+
+    ctiprd::io::TrajectoryReader reader {path};
+    REQUIRE(reader.nFrames() == 10);
+    REQUIRE_THROWS(reader.positions<double>(0));
+    REQUIRE_THROWS(reader.frame(10));
+
+    // random access, back to front
+    for (std::size_t k = 10; k-- > 0;) {
+        const auto frame = reader.frame(k);
+        REQUIRE(frame.step == 5 * k);
+        const auto positions = reader.positions<float>(k);
+        REQUIRE(std::equal(begin(positions), end(positions), begin(expected[k]), end(expected[k])));
+
+        const auto types = reader.types<ParticleType>(k);
+        REQUIRE(std::is_sorted(begin(types), end(types)));
+
+        const auto predators = reader.positions<float>(k, System::predatorId);
+        REQUIRE(predators.size() == 2 * frame.counts[System::predatorId]);
+        REQUIRE(predators.data() == positions.data() + 2 * frame.typeOffset(System::predatorId));
+    }
+
+    {
+        auto [first, last] = reader.frameRange(10, 25);
+        REQUIRE(first == 2);
+        REQUIRE(last == 5);
+    }
+    {
+        auto [first, last] = reader.frameRange(11, 11);
+        REQUIRE(first == last);
+    }
+    {
+        auto [first, last] = reader.frameRange(0, 1000);
+        REQUIRE(first == 0);
+        REQUIRE(last == 10);
+    }
+
+    // frames pointing past the end of the file are rejected when the index is loaded
+    const auto corrupted = std::filesystem::temp_directory_path() / "ctiprd_test_trajectory_reader_corrupted.bin";
+    const auto fileSize = std::filesystem::file_size(path);
+    for (const auto offset : {fileSize - sizeof(ctiprd::io::FrameHeader), fileSize + 64, std::uint64_t {0}}) {
+        std::filesystem::copy_file(path, corrupted, std::filesystem::copy_options::overwrite_existing);
+        {
+            std::fstream file (corrupted, std::ios::binary | std::ios::in | std::ios::out);
+            const auto entry = reader.header().indexOffset + 3 * sizeof(ctiprd::io::FrameIndexEntry);
+            file.seekp(static_cast<std::streamoff>(entry));
+            file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+        }
+        REQUIRE_THROWS_AS(ctiprd::io::TrajectoryReader{corrupted}, std::runtime_error);
+    }
+    std::filesystem::remove(corrupted);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Quantized trajectory round trip", "[io]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+    using ParticleType = ctiprd::systems::particle_type_t<System>;
+
+    System system {};
+    auto pool = ctiprd::config::make_pool(4);
+    auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+    integrator.particles()->initializeParticles(300, "prey");
+    integrator.particles()->initializeParticles(100, "predator");
+    integrator.particles()->removeParticle(7);
+
+    const ctiprd::io::QuantizationOptions options {.precision = 1e-5, .keyframeInterval = 4};
+    const auto path = std::filesystem::temp_directory_path() / "ctiprd_test_trajectory_quantized.bin";
+    std::vector<std::vector<float>> expected;
+    std::vector<std::vector<std::uint64_t>> expectedCounts;
+    {
+        ctiprd::io::TrajectoryWriter<System> writer {path, 4096, options};
+        for (std::size_t step = 0; step < 11; ++step) {
+            writer.record(step, integrator, pool);
+            std::vector<float> positions;
+            std::vector<std::uint64_t> counts;
+            for (std::size_t type = 0; type < System::types.size(); ++type) {
+                counts.push_back(0);
+                for (std::size_t i = 0; i < integrator.particles()->size(); ++i) {
+                    if (integrator.particles()->exists(i) && integrator.particles()->typeOf(i) == type) {
+                        const auto &pos = integrator.particles()->positionOf(i);
+                        positions.insert(end(positions), begin(pos.data), end(pos.data));
+                        ++counts.back();
+                    }
+                }
+            }
+            expected.push_back(positions);
+            expectedCounts.push_back(counts);
+            integrator.step(1e-2);
+        }
+    }
+
+    REQUIRE_THROWS(ctiprd::io::TrajectoryReader{path});
+    ctiprd::io::QuantizedTrajectoryReader reader {path};
+    REQUIRE(reader.nFrames() == 11);
+    REQUIRE(reader.header().keyframeInterval == 4);
+
+    const auto check = [&](std::size_t k) {
+        const auto frame = reader.frame<float, ParticleType>(k);
+        REQUIRE(frame.step == k);
+        REQUIRE(frame.counts == expectedCounts[k]);
+        REQUIRE(std::is_sorted(begin(frame.types), end(frame.types)));
+        REQUIRE(frame.positions.size() == expected[k].size());
+        for (std::size_t i = 0; i < frame.positions.size(); ++i) {
+            const auto tolerance = .5 * options.precision * System::boxSize[i % 2] + 1e-5;
+            REQUIRE(std::abs(frame.positions[i] - expected[k][i]) <= tolerance);
+        }
+    };
+    // sequential, then random access
+    for (std::size_t k = 0; k < reader.nFrames(); ++k) {
+        check(k);
+    }
+    for (auto k : {10, 3, 3, 9, 0, 6, 7}) {
+        check(k);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Quantized trajectory reader rejects truncated files", "[io]") {
+    using System = ctiprd::systems::LotkaVolterra<float>;
+
+    System system {};
+    auto pool = ctiprd::config::make_pool(2);
+    auto integrator = ctiprd::cpu::integrator::EulerMaruyama{system, pool};
+    integrator.particles()->initializeParticles(50, "prey");
+
+    const auto path = std::filesystem::temp_directory_path() / "ctiprd_test_trajectory_quantized_truncated.bin";
+    {
+        ctiprd::io::TrajectoryWriter<System> writer {path, 4096, ctiprd::io::QuantizationOptions {
+                .precision = 1e-5, .keyframeInterval = 4
+        }};
+        for (std::size_t step = 0; step < 6; ++step) {
+            writer.record(step, integrator, pool);
+            integrator.step(1e-2);
+        }
+    }
+    ctiprd::io::QuantizedTrajectoryReader reader {path};
+    const auto header = reader.header();
+    const auto entry = reader.index()[3];
+    const auto fileSize = std::filesystem::file_size(path);
+
+    const auto corrupted = std::filesystem::temp_directory_path() / "ctiprd_test_trajectory_quantized_corrupted.bin";
+    const auto rejected = [&](std::uint64_t position, std::uint64_t value) {
+        std::filesystem::copy_file(path, corrupted, std::filesystem::copy_options::overwrite_existing);
+        {
+            std::fstream file (corrupted, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(static_cast<std::streamoff>(position));
+            file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+        REQUIRE_THROWS_AS(ctiprd::io::QuantizedTrajectoryReader{corrupted}, std::runtime_error);
+    };
+    // frame count whose index size wraps around
+    rejected(offsetof(ctiprd::io::FileHeader, nFrames), std::uint64_t {1} << 61U);
+    // quantization axes overlapping the index
+    rejected(offsetof(ctiprd::io::FileHeader, dim), std::uint64_t {header.dtypeSize} << 32U | std::uint64_t {1} << 30U);
+    // frame offset past the end of the file
+    rejected(header.indexOffset + 3 * sizeof(ctiprd::io::FrameIndexEntry), fileSize + 64);
+    // payload past the end of the file
+    rejected(entry.offset + offsetof(ctiprd::io::FrameHeader, payloadBytes), fileSize);
+
+    // the index of a truncated file is gone
+    std::filesystem::copy_file(path, corrupted, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file(corrupted, entry.offset + sizeof(ctiprd::io::FrameHeader));
+    REQUIRE_THROWS_AS(ctiprd::io::QuantizedTrajectoryReader{corrupted}, std::runtime_error);
+
+    std::filesystem::remove(corrupted);
+    std::filesystem::remove(path);
+}